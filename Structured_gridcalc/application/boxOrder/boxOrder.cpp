@@ -0,0 +1,106 @@
+
+/******************************************************************************/
+/**
+ * \file boxOrder.cpp
+ *
+ * \brief Communication volume of an exchange for each BoxOrder
+ *
+ *  Boxes are ordered along each BoxOrder and given to processes in
+ *  contiguous ranges with equal cost (LoadBalance::contiguous).  For each
+ *  order, the motion items and ghost cells that each process receives
+ *  from other processes in a periodic exchange are reported.  The
+ *  layouts are computed for the requested number of processes so this
+ *  does not need to run in parallel.
+ *
+ *//*+*************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "DisjointBoxLayout.H"
+#include "LayoutIterator.H"
+
+static const char *const usage =
+  "Usage ./boxOrder [p [n [b [g]]]]\n"
+  "  p : number of processes (default=64).\n"
+  "  n : domain dimensions (default=256).\n"
+  "  b : maximum box dimensions (default=32).\n"
+  "  g : number of ghost cells (default=1).\n";
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, const char* argv[])
+{
+  if (argc > 1 && (std::strcmp(argv[1], "-h") == 0 ||
+                   std::strcmp(argv[1], "--help") == 0))
+    {
+      std::cout << usage;
+      return 0;
+    }
+
+  const int numProc  = (argc > 1) ? std::atoi(argv[1]) : 64;
+  const int n        = (argc > 2) ? std::atoi(argv[2]) : 256;
+  const int b        = (argc > 3) ? std::atoi(argv[3]) : 32;
+  const int numGhost = (argc > 4) ? std::atoi(argv[4]) : 1;
+  if (numProc <= 0 || n <= 0 || b <= 0 || numGhost < 0)
+    {
+      std::cout << usage;
+      return 1;
+    }
+
+  const Box domain(IntVect::Zero, (n - 1)*IntVect::Unit);
+  const unsigned periodic = PeriodicX | PeriodicY | PeriodicZ;
+
+  std::cout << std::left << std::setw(40) << "Domain: " << domain
+            << std::endl;
+  std::cout << std::left << std::setw(40) << "Box size: " << b << std::endl;
+  std::cout << std::left << std::setw(40) << "Ghost cells: " << numGhost
+            << std::endl;
+  std::cout << std::left << std::setw(40) << "Processes: " << numProc
+            << std::endl;
+  std::cout << std::endl;
+  std::cout << std::left << std::setw(16) << "Order"
+            << std::right << std::setw(12) << "Msg avg"
+            << std::setw(12) << "Msg max"
+            << std::setw(14) << "Cells avg"
+            << std::setw(14) << "Cells max"
+            << std::setw(14) << "Cells total" << std::endl;
+
+  const char *const orderName[] = { "lexicographic", "morton", "hilbert" };
+  const BoxOrder order[] = {
+    BoxOrder::lexicographic,
+    BoxOrder::morton,
+    BoxOrder::hilbert
+  };
+  for (int iOrder = 0; iOrder != 3; ++iOrder)
+    {
+      DisjointBoxLayout dbl;
+      dbl.defineForProcs(numProc, 0, domain, b*IntVect::Unit, order[iOrder],
+                         LoadBalance::contiguous, std::vector<Real>{});
+      const std::vector<DisjointBoxLayout::CommVolume> volume =
+        dbl.commVolume(numGhost, periodic);
+      long long sumMsg = 0;
+      long long sumCell = 0;
+      int maxMsg = 0;
+      long long maxCell = 0;
+      for (const DisjointBoxLayout::CommVolume& vol : volume)
+        {
+          sumMsg += vol.numMsg;
+          sumCell += vol.numCell;
+          maxMsg = std::max(maxMsg, vol.numMsg);
+          maxCell = std::max(maxCell, vol.numCell);
+        }
+      std::cout << std::left << std::setw(16) << orderName[iOrder]
+                << std::right << std::fixed << std::setprecision(1)
+                << std::setw(12) << (double)sumMsg/numProc
+                << std::setw(12) << maxMsg
+                << std::setw(14) << (double)sumCell/numProc
+                << std::setw(14) << maxCell
+                << std::setw(14) << sumCell << std::endl;
+    }
+  return 0;
+}
@@ -0,0 +1,254 @@
+
+/******************************************************************************/
+/**
+ * \file exchangeBench.cpp
+ *
+ * \brief Time of a ghost-cell exchange for each CopierProtocol and
+ *         CopierMessages
+ *
+ *  A periodic domain is split into boxes and distributed among the
+ *  processes.  For each protocol and grouping of messages, a Copier is
+ *  defined once and the time for a number of exchanges is measured.  The
+ *  average time of an exchange on the slowest process is reported, along
+ *  with the number of messages sent by each process.  Without MPI, only
+ *  local copies are performed and all copiers are the same.  With MPI,
+ *  the exchange is also timed with direct copies between processes on
+ *  the same node (CopierOnNode::sharedMemory).  Then, for
+ *  each CopierThreading, the exchange is timed with 1, 2, 4, ... up to
+ *  the maximum number of OpenMP threads.
+ *
+ *//*+*************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "DisjointBoxLayout.H"
+#include "LevelData.H"
+#include "BaseFab.H"
+#include "Stopwatch.H"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#define omp_get_max_threads() 1
+#define omp_set_num_threads(x)
+#endif
+
+static const char *const usage =
+  "Usage ./exchangeBench [n [b [c [g [i [t]]]]]]\n"
+  "  n : domain dimensions (default=64).\n"
+  "  b : maximum box dimensions (default=16).\n"
+  "  c : number of components (default=1).\n"
+  "  g : number of ghost cells (default=1).\n"
+  "  i : number of exchanges timed (default=1000).\n"
+  "  t : maximum number of OpenMP threads (default=OMP_NUM_THREADS).\n";
+
+/*----------------------------------------------------------------------------*/
+//  Average time of an exchange in microseconds (after a warm up)
+/*----------------------------------------------------------------------------*/
+
+static double
+timeExchange(LevelData<BaseFab<Real> >& a_data,
+             Copier&                    a_copier,
+             const int                  a_numIter)
+{
+  for (int iter = 0; iter != 10; ++iter)
+    {
+      a_data.exchange(a_copier);
+    }
+#ifdef USE_MPI
+  MPI_Barrier(MPI_COMM_WORLD);
+#endif
+  Stopwatch<> timerExchange;
+  timerExchange.start();
+  for (int iter = 0; iter != a_numIter; ++iter)
+    {
+      a_data.exchange(a_copier);
+    }
+  timerExchange.stop();
+  return timerExchange.time<std::micro>()/a_numIter;
+}
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, const char* argv[])
+{
+  DisjointBoxLayout::initMPI(argc, argv);
+  const bool masterProc = (DisjointBoxLayout::procID() == 0);
+
+  if (argc > 1 && (std::strcmp(argv[1], "-h") == 0 ||
+                   std::strcmp(argv[1], "--help") == 0))
+    {
+      if (masterProc) std::cout << usage;
+      DisjointBoxLayout::finalizeMPI();
+      return 0;
+    }
+
+  const int n        = (argc > 1) ? std::atoi(argv[1]) : 64;
+  const int b        = (argc > 2) ? std::atoi(argv[2]) : 16;
+  const int numComp  = (argc > 3) ? std::atoi(argv[3]) : 1;
+  const int numGhost = (argc > 4) ? std::atoi(argv[4]) : 1;
+  const int numIter  = (argc > 5) ? std::atoi(argv[5]) : 1000;
+  const int maxThread =
+    (argc > 6) ? std::atoi(argv[6]) : omp_get_max_threads();
+  if (n <= 0 || b <= 0 || numComp <= 0 || numGhost < 0 || numIter <= 0 ||
+      maxThread <= 0)
+    {
+      if (masterProc) std::cout << usage;
+      DisjointBoxLayout::finalizeMPI();
+      return 1;
+    }
+
+  const Box domain(IntVect::Zero, (n - 1)*IntVect::Unit);
+  DisjointBoxLayout dbl(domain, b*IntVect::Unit, BoxOrder::hilbert);
+  LevelData<BaseFab<Real> > data(dbl, numComp, numGhost);
+  data.setVal((Real)DisjointBoxLayout::procID());
+
+  if (masterProc)
+    {
+      std::cout << std::left << std::setw(40) << "Domain: " << domain
+                << std::endl;
+      std::cout << std::left << std::setw(40) << "Box size: " << b
+                << std::endl;
+      std::cout << std::left << std::setw(40) << "Boxes: " << dbl.size()
+                << std::endl;
+      std::cout << std::left << std::setw(40) << "Components: " << numComp
+                << std::endl;
+      std::cout << std::left << std::setw(40) << "Ghost cells: " << numGhost
+                << std::endl;
+      std::cout << std::left << std::setw(40) << "Processes: "
+                << DisjointBoxLayout::numProc() << std::endl;
+      std::cout << std::endl;
+      std::cout << std::left << std::setw(16) << "Protocol"
+                << std::setw(16) << "Messages"
+                << std::right << std::setw(12) << "Msg max"
+                << std::setw(16) << "Define (us)"
+                << std::setw(16) << "Exchange (us)" << std::endl;
+    }
+
+  const char *const protocolName[] = {
+    "nonblocking", "persistent", "putFence", "putPSCW", "neighborhood"
+  };
+  const CopierProtocol protocol[] = {
+    CopierProtocol::nonblocking,
+    CopierProtocol::persistent,
+    CopierProtocol::putFence,
+    CopierProtocol::putPSCW,
+    CopierProtocol::neighborhood
+  };
+  const char *const messagesName[] = { "perMotionItem", "perProcess" };
+  const CopierMessages messages[] = {
+    CopierMessages::perMotionItem,
+    CopierMessages::perProcess
+  };
+  for (int iCopier = 0; iCopier != 10; ++iCopier)
+    {
+      const int iProt = iCopier % 5;
+      const int iMsg = iCopier / 5;
+      Stopwatch<> timerDefine;
+      Copier copier(protocol[iProt], messages[iMsg]);
+      timerDefine.start();
+      copier.defineExchangeLD(data, PeriodicX | PeriodicY | PeriodicZ);
+      timerDefine.stop();
+      double time[3] = {
+        timerDefine.time<std::micro>(),
+        timeExchange(data, copier, numIter),
+        0.
+      };
+#ifdef USE_MPI
+      time[2] = copier.numMessage();
+      double maxTime[3];
+      MPI_Reduce(time, maxTime, 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+      time[0] = maxTime[0];
+      time[1] = maxTime[1];
+      time[2] = maxTime[2];
+#endif
+      if (masterProc)
+        {
+          std::cout << std::left << std::setw(16) << protocolName[iProt]
+                    << std::setw(16) << messagesName[iMsg]
+                    << std::right << std::setw(12) << (int)time[2]
+                    << std::fixed << std::setprecision(2)
+                    << std::setw(16) << time[0]
+                    << std::setw(16) << time[1] << std::endl;
+        }
+    }
+
+#ifdef USE_MPI
+  // Direct copies between processes on the same node
+  {
+    LevelData<BaseFab<Real> > dataShared;
+    dataShared.defineShared(dbl, numComp, numGhost);
+    dataShared.setVal((Real)DisjointBoxLayout::procID());
+    Stopwatch<> timerDefine;
+    Copier copier(CopierProtocol::persistent,
+                  CopierMessages::perProcess,
+                  CopierOnNode::sharedMemory);
+    timerDefine.start();
+    copier.defineExchangeLD(dataShared, PeriodicX | PeriodicY | PeriodicZ);
+    timerDefine.stop();
+    double time[3] = {
+      timerDefine.time<std::micro>(),
+      timeExchange(dataShared, copier, numIter),
+      (double)copier.numMessage()
+    };
+    double maxTime[3];
+    MPI_Reduce(time, maxTime, 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (masterProc)
+      {
+        std::cout << std::left << std::setw(16) << "persistent"
+                  << std::setw(16) << "sharedMemory"
+                  << std::right << std::setw(12) << (int)maxTime[2]
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(16) << maxTime[0]
+                  << std::setw(16) << maxTime[1] << std::endl;
+      }
+  }
+#endif
+
+  // Scaling with threads for the default protocol and messages
+  if (masterProc)
+    {
+      std::cout << std::endl;
+      std::cout << std::left << std::setw(16) << "Threads"
+                << std::right << std::setw(20) << "perCopy (us)"
+                << std::setw(20) << "motionItems (us)" << std::endl;
+    }
+  for (int numThread = 1; numThread <= maxThread;
+       numThread = (numThread == maxThread) ?
+         maxThread + 1 : std::min(2*numThread, maxThread))
+    {
+      omp_set_num_threads(numThread);
+      double time[2];
+      const CopierThreading threading[] = {
+        CopierThreading::perCopy,
+        CopierThreading::motionItems
+      };
+      for (int iThr = 0; iThr != 2; ++iThr)
+        {
+          Copier copier;
+          copier.setThreading(threading[iThr]);
+          copier.defineExchangeLD(data, PeriodicX | PeriodicY | PeriodicZ);
+          time[iThr] = timeExchange(data, copier, numIter);
+        }
+#ifdef USE_MPI
+      double maxTime[2];
+      MPI_Reduce(time, maxTime, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+      time[0] = maxTime[0];
+      time[1] = maxTime[1];
+#endif
+      if (masterProc)
+        {
+          std::cout << std::left << std::setw(16) << numThread
+                    << std::right << std::fixed << std::setprecision(2)
+                    << std::setw(20) << time[0]
+                    << std::setw(20) << time[1] << std::endl;
+        }
+    }
+
+  DisjointBoxLayout::finalizeMPI();
+  return 0;
+}
@@ -0,0 +1,185 @@
+
+/******************************************************************************/
+/**
+ * \file firstTouch.cpp
+ *
+ * \brief Memory bandwidth of LevelData kernels for each first-touch placement
+ *
+ *  A triad, c = a + s*b, is run over a LevelData with the two ways kernels
+ *  are threaded in the framework: all threads on each box (MD_BOXLOOP_OMP)
+ *  and one thread per box (static schedule over the DataIterator).  The
+ *  memory is first touched with each FirstTouch mode.  On a multi-socket
+ *  node, run with bound threads ('export OMP_PROC_BIND=TRUE') spread over
+ *  all sockets.  Placement only matters if it matches the kernel threading.
+ *
+ *//*+*************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "LevelData.H"
+#include "BaseFabMacros.H"
+#include "FabAllocator.H"
+#include "Stopwatch.H"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#define omp_get_max_threads() 1
+#endif
+
+static const char *const usage =
+  "Usage ./firstTouch [-np x] [n [b [i]]]\n"
+  "  x : number of threads for OpenMP.  You can also use\n"
+  "      'export OMP_NUM_THREADS=x' to use x threads with OpenMP.\n"
+  "  n : domain dimensions (default=256).\n"
+  "  b : box dimensions (n must be a multiple of b, default=64).\n"
+  "  i : number of iterations (i > 0, default=20).\n"
+  "\n  Use 'export OMP_PROC_BIND=TRUE' to lock thread affinity in OpenMP.\n";
+
+using LevelFab = LevelData<BaseFab<Real> >;
+
+/*--------------------------------------------------------------------*/
+//  Triad with all threads working on each box
+/*--------------------------------------------------------------------*/
+
+void triadCells(LevelFab& a_c, const LevelFab& a_a, const LevelFab& a_b,
+                const Real a_s)
+{
+  const DisjointBoxLayout& dbl = a_c.disjointBoxLayout();
+  for (DataIterator dit(dbl); dit.ok(); ++dit)
+    {
+      MD_ARRAY_RESTRICT(arrA, a_a[dit]);
+      MD_ARRAY_RESTRICT(arrB, a_b[dit]);
+      MD_ARRAY_RESTRICT(arrC, a_c[dit]);
+      MD_BOXLOOP_OMP(dbl[dit], i)
+        {
+          arrC[MD_IX(i, 0)] = arrA[MD_IX(i, 0)] + a_s*arrB[MD_IX(i, 0)];
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Triad with one thread working on each box
+/*--------------------------------------------------------------------*/
+
+void triadBoxes(LevelFab& a_c, const LevelFab& a_a, const LevelFab& a_b,
+                const Real a_s, const std::vector<BoxIndex>& a_bidx)
+{
+  const DisjointBoxLayout& dbl = a_c.disjointBoxLayout();
+  const int numBox = a_bidx.size();
+#pragma omp parallel for default(shared) schedule(static)
+  for (int idx = 0; idx < numBox; ++idx)
+    {
+      const BoxIndex& bidx = a_bidx[idx];
+      MD_ARRAY_RESTRICT(arrA, a_a[bidx]);
+      MD_ARRAY_RESTRICT(arrB, a_b[bidx]);
+      MD_ARRAY_RESTRICT(arrC, a_c[bidx]);
+      MD_BOXLOOP(dbl[bidx], i)
+        {
+          arrC[MD_IX(i, 0)] = arrA[MD_IX(i, 0)] + a_s*arrB[MD_IX(i, 0)];
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+
+int main(int argc, const char* argv[])
+{
+  if (argc > 1 && (std::strcmp(argv[1], "-h") == 0 ||
+                   std::strcmp(argv[1], "--help") == 0))
+    {
+      std::cout << usage;
+      return 0;
+    }
+
+  int iargc = 1;
+  if (argc > iargc + 1 && std::strcmp(argv[iargc], "-np") == 0)
+    {
+#ifdef _OPENMP
+      omp_set_num_threads(std::atoi(argv[iargc+1]));
+#endif
+      iargc += 2;
+    }
+  const int n       = (argc > iargc)     ? std::atoi(argv[iargc])     : 256;
+  const int b       = (argc > iargc + 1) ? std::atoi(argv[iargc + 1]) : 64;
+  const int numIter = (argc > iargc + 2) ? std::atoi(argv[iargc + 2]) : 20;
+  if (n <= 0 || b <= 0 || n % b != 0 || numIter <= 0)
+    {
+      std::cout << usage;
+      return 1;
+    }
+
+#ifdef __GLIBC__
+  // A fixed threshold has malloc map fresh (untouched) pages for every
+  // box instead of recycling freed heap memory
+  mallopt(M_MMAP_THRESHOLD, 128*1024);
+#endif
+
+  const Box domain(IntVect::Zero, (n - 1)*IntVect::Unit);
+  DisjointBoxLayout dbl(domain, b*IntVect::Unit);
+  std::vector<BoxIndex> bidx;
+  for (DataIterator dit(dbl); dit.ok(); ++dit)
+    {
+      bidx.push_back(*dit);
+    }
+  const double numBytes = 3.*sizeof(Real)*domain.size()*numIter;
+
+  std::cout << std::left << std::setw(40) << "Domain: " << domain
+            << std::endl;
+  std::cout << std::left << std::setw(40) << "Box size: " << b << std::endl;
+  std::cout << std::left << std::setw(40) << "Iterations: " << numIter
+            << std::endl;
+  std::cout << std::left << std::setw(40) << "Parallel OpenMP threads: "
+            << omp_get_max_threads() << std::endl;
+  std::cout << std::endl;
+  std::cout << std::left << std::setw(16) << "First touch"
+            << std::right << std::setw(24) << "Threads/box (GB/s)"
+            << std::setw(24) << "Boxes/thread (GB/s)" << std::endl;
+
+  const char *const touchName[] = { "master", "cells", "boxes" };
+  const FirstTouch touchMode[] = {
+    FirstTouch::master,
+    FirstTouch::cells,
+    FirstTouch::boxes
+  };
+  for (int iMode = 0; iMode != 3; ++iMode)
+    {
+      // Make sure memory is fresh
+      FabAllocator::current().release();
+      LevelFab a(dbl, 1, 0);
+      LevelFab bb(dbl, 1, 0);
+      LevelFab c(dbl, 1, 0);
+      a.setVal(1., touchMode[iMode]);
+      bb.setVal(2., touchMode[iMode]);
+      c.setVal(0., touchMode[iMode]);
+      double bandwidth[2];
+      for (int iKernel = 0; iKernel != 2; ++iKernel)
+        {
+          // Warm up
+          if (iKernel == 0) triadCells(c, a, bb, 0.5);
+          else              triadBoxes(c, a, bb, 0.5, bidx);
+          Stopwatch<> timer;
+          timer.start();
+          for (int iter = 0; iter != numIter; ++iter)
+            {
+              if (iKernel == 0) triadCells(c, a, bb, 0.5);
+              else              triadBoxes(c, a, bb, 0.5, bidx);
+            }
+          timer.stop();
+          bandwidth[iKernel] = numBytes/(timer.time<std::ratio<1> >()*1.E9);
+        }
+      std::cout << std::left << std::setw(16) << touchName[iMode]
+                << std::right << std::fixed << std::setprecision(2)
+                << std::setw(24) << bandwidth[0]
+                << std::setw(24) << bandwidth[1] << std::endl;
+    }
+  return 0;
+}
@@ -2,122 +2,143 @@
 #include "LBPatch.H"
 #include "LevelData.H"
 
-//Advance a time step
-void LBLevel::advance()
+//Build the tasks of a time step.  Nothing waits for a whole level: each
+//tile streams as soon as the collisions of its box are done (and, next to
+//ghost cells, once those are filled), and computes its macroscopic
+//quantities right after.  Messages are packed, sent, and unpacked by tasks
+//of the exchange while other tiles are computed.
+void LBLevel::defineGraph()
 {
-	//Collision
-	LBPatch::collision(m_curr,m_macro_comps,m_dbl);
-	
-	//Exchange
-	Copier copier;
-	copier.defineExchangeLD(m_curr,PeriodicX | PeriodicY,TrimCorner);	
-	m_curr.exchange(copier);
-
-	//Fill ghost cells on top/bottom boundary and fill x,y ghost cells using periodic conditions
-	//Using non-slip condictions
-	Box temp_box;
-	IntVect temp_lo;
-	IntVect temp_hi;
-	IntVect curr_vect;
+	m_graph.clear();
+	const IntVect tileSize = TileIterator::defaultTileSize();
+	const int numLocalBox = m_dbl.localSize();
+	const int numItem = TileIterator::numItem(m_dbl,tileSize);
+	//Collisions of each tile, joined per box
+	std::vector<int> collideTask(numItem);
+	for(int item = 0;item<numItem;++item)
+	{
+		collideTask[item] = m_graph.addTask([this,tileSize,item]
+		{
+			TileIterator tit(m_dbl,tileSize,item,item+1);
+			LBPatch::collision(tit.tileBox(),m_curr[tit],m_macro_comps[tit]);
+		});
+	}
+	std::vector<int> collideJoin(numLocalBox);
+	for(int ib = 0;ib<numLocalBox;++ib)
+	{
+		collideJoin[ib] = m_graph.addJoin();
+	}
+	for(int item = 0;item<numItem;++item)
+	{
+		TileIterator tit(m_dbl,tileSize,item,item+1);
+		m_graph.addDependency(collideJoin[(*tit).localIndex()],collideTask[item]);
+	}
+	//Boundary conditions on top/bottom of each box
+	std::vector<int> bcTask(numLocalBox);
 	for(DataIterator dit(m_dbl);dit.ok();++dit)
 	{
-		/* NOTE: This stuff was to do periodic conditions "manually", but it would definitely fail if not on 1 or 2 processors
-		if(m_dbl[dit].loVect(0)==(m_dbl.problemDomain()).loVect(0))
-		{//on left y boundary
-			temp_lo = m_dbl[dit].loVect();
-			temp_hi = m_dbl[dit].hiVect();
-			temp_hi[0] = m_dbl[dit].loVect(0);
-			temp_box = Box(temp_lo,temp_hi);
-			//std::cout << temp_box << std::endl;
-			temp_box = temp_box.shift(IntVect(-1,0,0));//shift so dst box are ghost cells
-			DataIterator temp_dit = dit;
-			for(int ii = 0;ii<3;++ii){++temp_dit;}
-			IntVect period_hi = m_dbl[temp_dit].hiVect();//Should fix the +3 to be a stride
-			IntVect period_lo = m_dbl[temp_dit].loVect();
-			period_lo[0] = period_hi[0];
-			Box periodic_box = Box(period_lo,period_hi);//right boundary
-			//std::cout << periodic_box << std::endl;
-			m_curr[dit].copy(temp_box,0,m_curr[temp_dit],periodic_box,0,LBParameters::g_numVelDir);
-			temp_box = temp_box.shift(IntVect(1,0,0));
-			periodic_box = periodic_box.shift(IntVect(1,0,0));
-			m_curr[temp_dit].copy(periodic_box,0,m_curr[dit],temp_box,0,LBParameters::g_numVelDir);
-		}		
-		if(m_dbl[dit].loVect(1)==(m_dbl.problemDomain()).loVect(1))
-		{//on low x boundary
-			temp_lo = m_dbl[dit].loVect();
-			temp_hi = m_dbl[dit].hiVect();
-			temp_hi[1] = temp_lo[1];
-			temp_box = Box(temp_lo,temp_hi);
-			temp_box = temp_box.shift(IntVect(0,-1,0));
-			//std::cout << temp_box << std::endl;
-			DataIterator temp_dit = dit;
-			for(int ii = 0;ii<4;++ii){++temp_dit;}
-			IntVect period_hi = m_dbl[temp_dit].hiVect();
-			IntVect period_lo = m_dbl[temp_dit].loVect();
-			period_lo[1] = period_hi[1];
-			Box periodic_box = Box(period_lo,period_hi);
-			//std::cout << periodic_box << std::endl;
-			m_curr[dit].copy(temp_box,0,m_curr[temp_dit],periodic_box,0,LBParameters::g_numVelDir);
-			temp_box = temp_box.shift(IntVect(0,1,0));
-			periodic_box = periodic_box.shift(IntVect(0,1,0));
-   			m_curr[temp_dit].copy(periodic_box,0,m_curr[dit],temp_box,0,LBParameters::g_numVelDir);
-		}		
-		*/
-		if(m_dbl[dit].hiVect(2) == (m_dbl.problemDomain()).hiVect(2))
-                {//on top of domain     
-                        temp_lo = IntVect(m_dbl[dit].loVect(0),m_dbl[dit].loVect(1),m_dbl[dit].hiVect(2));
-                        temp_hi = m_dbl[dit].hiVect();
-                        temp_box = Box(temp_lo,temp_hi);
-                        MD_BOXLOOP_OMP(temp_box,i)
-                        {
-                                curr_vect = IntVect(i0,i1,i2);
-                                m_curr[dit](curr_vect+LBParameters::latticeVelocity(6),5)   = m_curr[dit](curr_vect,6);
-                                m_curr[dit](curr_vect+LBParameters::latticeVelocity(13),12) = m_curr[dit](curr_vect,13);
-				m_curr[dit](curr_vect+LBParameters::latticeVelocity(14),11) = m_curr[dit](curr_vect,14);
-				m_curr[dit](curr_vect+LBParameters::latticeVelocity(17),16) = m_curr[dit](curr_vect,17);
-				m_curr[dit](curr_vect+LBParameters::latticeVelocity(18),15) = m_curr[dit](curr_vect,18);
-				
-				/*
-                                m_curr[dit](curr_vect+e6,5)   = m_curr[dit](curr_vect,6);
-                                m_curr[dit](curr_vect+e13,12) = m_curr[dit](curr_vect,13);
-                                m_curr[dit](curr_vect+e14,11) = m_curr[dit](curr_vect,14);
-                                m_curr[dit](curr_vect+e17,16) = m_curr[dit](curr_vect,17);
-                                m_curr[dit](curr_vect+e18,15) = m_curr[dit](curr_vect,18);
-				*/
-                        }
-                }
-                else if(m_dbl[dit].loVect(2) == (m_dbl.problemDomain()).loVect(2))
-                {//on bottom of domain
-                        temp_lo = m_dbl[dit].loVect();
-                        temp_hi = m_dbl[dit].hiVect();
-                        temp_hi[2] = m_dbl[dit].loVect(2);
-                        temp_box = Box(temp_lo,temp_hi);
-                        MD_BOXLOOP_OMP(temp_box,i)
-                        {
-                                curr_vect = IntVect(i0,i1,i2);
-                         
-				m_curr[dit](curr_vect+LBParameters::latticeVelocity(5),6)   = m_curr[dit](curr_vect,5);
-                                m_curr[dit](curr_vect+LBParameters::latticeVelocity(12),13) = m_curr[dit](curr_vect,12);
-                                m_curr[dit](curr_vect+LBParameters::latticeVelocity(11),14) = m_curr[dit](curr_vect,11);
-                                m_curr[dit](curr_vect+LBParameters::latticeVelocity(16),17) = m_curr[dit](curr_vect,16);
-                                m_curr[dit](curr_vect+LBParameters::latticeVelocity(15),18) = m_curr[dit](curr_vect,15);
-				/*
-			       m_curr[dit](curr_vect+e5,6)   = m_curr[dit](curr_vect,5);
-                                m_curr[dit](curr_vect+e12,13) = m_curr[dit](curr_vect,12);
-                                m_curr[dit](curr_vect+e11,14) = m_curr[dit](curr_vect,11);
-                                m_curr[dit](curr_vect+e16,17) = m_curr[dit](curr_vect,16);
-                                m_curr[dit](curr_vect+e15,18) = m_curr[dit](curr_vect,15);
-				*/
-                        }
-                }
-	}	
-	
-	
-	//Stream
-	LBPatch::stream(m_dbl,m_curr,m_prev);
-	
-	//Macroscopic
-	LBPatch::macroscopic(m_dbl,m_curr,m_macro_comps);
+		const BoxIndex bidx = *dit;
+		const int ib = bidx.localIndex();
+		bcTask[ib] = m_graph.addTask([this,bidx]{ fillBoundary(bidx); },
+		                             TaskPriority::urgent);
+		m_graph.addDependency(bcTask[ib],collideJoin[ib]);
+	}
+	//Exchange of each box once its collisions are done
+	std::vector<int> ghostTask;
+	m_curr.addExchangeTasks(m_graph,m_copier,collideJoin,ghostTask);
+	//Stream and macroscopic for each tile (m_prev becomes m_curr after the
+	//swap)
+	for(int item = 0;item<numItem;++item)
+	{
+		TileIterator tit(m_dbl,tileSize,item,item+1);
+		const int ib = (*tit).localIndex();
+		const int interiorTask = m_graph.addTask([this,tileSize,item]
+		{
+			TileIterator tit(m_dbl,tileSize,item,item+1);
+			Box region = tit.tileBox();
+			region &= m_dbl.interiorBox(*tit,LBParameters::g_numGhost);
+			LBPatch::stream(region,m_curr[tit],m_prev[tit]);
+		});
+		m_graph.addDependency(interiorTask,collideJoin[ib]);
+		bool nextToGhost = false;
+		for(const Box& box : m_dbl.boundaryBoxes(*tit,LBParameters::g_numGhost))
+		{
+			Box region(box);
+			region &= tit.tileBox();
+			nextToGhost = nextToGhost || !region.isEmpty();
+		}
+		int boundaryTask = -1;
+		if(nextToGhost)
+		{
+			boundaryTask = m_graph.addTask([this,tileSize,item]
+			{
+				TileIterator tit(m_dbl,tileSize,item,item+1);
+				const Box tile = tit.tileBox();
+				for(const Box& box : m_dbl.boundaryBoxes(*tit,LBParameters::g_numGhost))
+				{
+					Box region(box);
+					region &= tile;
+					LBPatch::stream(region,m_curr[tit],m_prev[tit]);
+				}
+			});
+			m_graph.addDependency(boundaryTask,collideJoin[ib]);
+			m_graph.addDependency(boundaryTask,bcTask[ib]);
+			m_graph.addDependency(boundaryTask,ghostTask[ib]);
+		}
+		const int macroTask = m_graph.addTask([this,tileSize,item]
+		{
+			TileIterator tit(m_dbl,tileSize,item,item+1);
+			LBPatch::macroscopic(tit.tileBox(),m_prev[tit],m_macro_comps[tit]);
+		});
+		m_graph.addDependency(macroTask,interiorTask);
+		m_graph.addDependency(macroTask,boundaryTask);
+	}
+}
+
+//Fill ghost cells on top/bottom boundary of a box using non-slip
+//conditions (x,y ghost cells are filled by the periodic exchange)
+void LBLevel::fillBoundary(const BoxIndex& a_bidx)
+{
+	const Box& box = m_dbl[a_bidx];
+	LBPatch::SolFab& curr = m_curr[a_bidx];
+	if(box.hiVect(2) == (m_dbl.problemDomain()).hiVect(2))
+	{//on top of domain
+		const IntVect temp_lo(box.loVect(0),box.loVect(1),box.hiVect(2));
+		const Box temp_box(temp_lo,box.hiVect());
+		MD_BOXLOOP(temp_box,i)
+		{
+			const IntVect curr_vect(i0,i1,i2);
+			curr(curr_vect+LBParameters::latticeVelocity(6),5)   = curr(curr_vect,6);
+			curr(curr_vect+LBParameters::latticeVelocity(13),12) = curr(curr_vect,13);
+			curr(curr_vect+LBParameters::latticeVelocity(14),11) = curr(curr_vect,14);
+			curr(curr_vect+LBParameters::latticeVelocity(17),16) = curr(curr_vect,17);
+			curr(curr_vect+LBParameters::latticeVelocity(18),15) = curr(curr_vect,18);
+		}
+	}
+	else if(box.loVect(2) == (m_dbl.problemDomain()).loVect(2))
+	{//on bottom of domain
+		IntVect temp_hi = box.hiVect();
+		temp_hi[2] = box.loVect(2);
+		const Box temp_box(box.loVect(),temp_hi);
+		MD_BOXLOOP(temp_box,i)
+		{
+			const IntVect curr_vect(i0,i1,i2);
+			curr(curr_vect+LBParameters::latticeVelocity(5),6)   = curr(curr_vect,5);
+			curr(curr_vect+LBParameters::latticeVelocity(12),13) = curr(curr_vect,12);
+			curr(curr_vect+LBParameters::latticeVelocity(11),14) = curr(curr_vect,11);
+			curr(curr_vect+LBParameters::latticeVelocity(16),17) = curr(curr_vect,16);
+			curr(curr_vect+LBParameters::latticeVelocity(15),18) = curr(curr_vect,15);
+		}
+	}
+}
+
+//Advance a time step
+void LBLevel::advance()
+{
+	//Collision, boundary conditions, exchange, stream, and macroscopic as
+	//tasks of the graph
+	m_graph.execute();
+	LBPatch::swap(m_curr,m_prev);
 }
 
 /*--------------------------------------------------------------------*/
@@ -1,5 +1,6 @@
 #include "LBLevel.H"
 #include "Stopwatch.H"
+#include "MemoryTracker.H"
 #include <chrono>
 
 /******************************************************************************/
@@ -51,6 +52,13 @@ int main(int argc, const char* argv[])
 	
 	stopwatch.stop();
 	std::cout <<stopwatch.time() << std::endl;
+	if (DisjointBoxLayout::procID() == 0)
+	{
+		std::cout << std::endl;
+		MemoryTracker::report(std::cout);
+	}
+	//Free the cached copiers before MPI
+	Copier::clearCache();
 	DisjointBoxLayout::finalizeMPI();				
 	
   // Setup input parameters
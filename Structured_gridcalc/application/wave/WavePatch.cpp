@@ -11,8 +11,14 @@
 #include <iomanip>
 #include <iostream>
 #include <cmath>
+#include <cstdint>
+#include <algorithm>
 
+#ifdef USE_MPI
+#include "pcgnslib.h"
+#else
 #include "cgnslib.h"
+#endif
 
 #include "BaseFabMacros.H"
 #include "WavePatch.H"
@@ -44,16 +50,27 @@ const int VecSz_r = 1;
 
 /*--------------------------------------------------------------------*/
 //  Constructor
-/*--------------------------------------------------------------------*/
+/** \param[in]  a_haloDepth
+ *                      Number of ghost cells filled at once.  The
+ *                      boundary is filled every a_haloDepth steps
+ *                      and, in between, the solution is also computed
+ *                      in the ghost cells still needed by later
+ *                      steps (default 1, fill every step).
+ *  \param[in]  a_tileSize
+ *                      Size of the tiles of each box distributed
+ *                      among threads by the kernels
+ *//*-----------------------------------------------------------------*/
 
 WavePatch::WavePatch(const Box&        a_domain,
                      const IntVect&    a_maxBoxSize,
                      const char* const a_basePlotName,
                      const Real        a_c,
                      const Real        a_dx,
-                     const Real        a_cfl)
+                     const Real        a_cfl,
+                     const int         a_haloDepth,
+                     const IntVect&    a_tileSize)
   :
-  m_boxes(a_domain, a_maxBoxSize),
+  m_boxes(a_domain, a_maxBoxSize, BoxOrder::hilbert),
   m_domain(a_domain),
   m_basePlotName(a_basePlotName),
   m_c(a_c),
@@ -63,14 +80,53 @@ WavePatch::WavePatch(const Box&        a_domain,
   m_iteration(0),
   m_idxStep(0),
   m_idxStepUpdate(1),
-  m_idxStepOld(2)
+  m_idxStepOld(2),
+  m_haloDepth(a_haloDepth),
+  m_haloValid(0),
+  m_tileSize(a_tileSize)
 {
-  m_u[0].define(m_boxes, 1, 1);
-  m_u[1].define(m_boxes, 1, 1);
-  m_u[2].define(m_boxes, 1, 1);
+  CH_assert(m_haloDepth > 0);
+  // Ghost cells are only filled from adjacent boxes and reflected
+  // from within the box
+  for (DataIterator dit(m_boxes); dit.ok(); ++dit)
+    {
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          CH_assert(m_haloDepth <= m_boxes[dit].dimensions()[dir]);
+        }
+    }
+#ifdef USE_GPU
+  // The GPU kernels only update the domain as a single box
+  CH_assert(m_haloDepth == 1);
+  CH_assert(m_boxes.size() == 1);
+  m_u[0].define(m_boxes, 1, m_haloDepth);
+  m_u[1].define(m_boxes, 1, m_haloDepth);
+  m_u[2].define(m_boxes, 1, m_haloDepth);
+#else
+  // Pad rows so that the first interior cell of each pencil is aligned
+  const FabPadding padding = FabPadding::cacheLine(m_haloDepth);
+  m_u[0].define(m_boxes, 1, m_haloDepth, padding);
+  m_u[1].define(m_boxes, 1, m_haloDepth, padding);
+  m_u[2].define(m_boxes, 1, m_haloDepth, padding);
+  {
+    // The same copier serves any assignment of time levels to m_u
+    LevelDataGroup<PatchSolData> group;
+    if (m_haloDepth > 1)
+      {
+        group.add(m_u[2]);
+      }
+    group.add(m_u[0]);
+    group.defineCopier(m_copierFill);
+  }
+#endif
+  // First touch with the same threading as the kernels in advance()
+  for (int idx = 0; idx != 3; ++idx)
+    {
+      m_u[idx].setVal(0., FirstTouch::threadPool, m_tileSize);
+    }
+#ifdef USE_GPU
   DataIterator dit(m_boxes);
   m_bidx = *dit;
-#ifdef USE_GPU
   // Pack the BaseFabs for each time index into an array
   const BaseFab<Real>* patchData[3];
   patchData[0] = &(m_u[0][m_bidx]);
@@ -109,28 +165,36 @@ WavePatch::initialData()
 {
   constexpr Real pi = 3.141592653589793;
 
-  MD_ARRAY_RESTRICT(arrun, un());
-  MD_BOXLOOP_OMP(m_domain, i)
+  for (DataIterator dit(m_boxes); dit.ok(); ++dit)
     {
-      D_TERM(const Real x = (i0 + 0.5)*m_dx;,
-             const Real y = (i1 + 0.5)*m_dx;,
-             const Real z = (i2 + 0.5)*m_dx;);
-      const Real r = std::sqrt(D_TERM(  std::pow(x - 0.5, 2),
-                                      + std::pow(y - 0.5, 2),
-                                      + std::pow(z - 0.5, 2)));
-      Real val = 0.;
-      if (r <= 0.5)
+      const Box& box = m_boxes[dit];
+      MD_ARRAY_RESTRICT(arrun, un()[dit]);
+      MD_BOXLOOP_OMP(box, i)
         {
-          val = std::pow(sin(pi*(r + 0.5)), 6);
+          D_TERM(const Real x = (i0 + 0.5)*m_dx;,
+                 const Real y = (i1 + 0.5)*m_dx;,
+                 const Real z = (i2 + 0.5)*m_dx;);
+          const Real r = std::sqrt(D_TERM(  std::pow(x - 0.5, 2),
+                                          + std::pow(y - 0.5, 2),
+                                          + std::pow(z - 0.5, 2)));
+          Real val = 0.;
+          if (r <= 0.5)
+            {
+              val = std::pow(sin(pi*(r + 0.5)), 6);
+            }
+          arrun[MD_IX(i, 0)] = val;
         }
-      arrun[MD_IX(i, 0)] = val;
+      unm1()[dit].copy(box, un()[dit]);
     }
-  unm1().copy(m_domain, un());
 }
 
 /*--------------------------------------------------------------------*/
 //  Advance one time step
-/** Compute unp1() and time n+1 from un() and unm1().
+/** Compute unp1() and time n+1 from un() and unm1().  The ghost cells
+ *  are filled every m_haloDepth steps.  After a fill, unp1() is
+ *  computed on each box grown by m_haloDepth - 1 and the growth is
+ *  reduced by one each step until the next fill.  The stencil reaches
+ *  one cell so each step consumes one layer of valid ghost cells.
  *//*-----------------------------------------------------------------*/
 
 void
@@ -138,33 +202,19 @@ WavePatch::advance()
 {
   m_timerAdvance.start();
 
-// Setup for VEX
-#ifdef USE_VEX
-  const int pencilSize  = m_domain.dimensions()[0];
-  const int vecPacked   = pencilSize/VecSz_r;
-  const int i0EndPacked = m_domain.loVect(0) + vecPacked*VecSz_r;
-  (void)i0EndPacked;
-#endif
-
-//--Set BC
+//--Set BC (on the CPU, done by the tasks of the update)
 
-#ifdef USE_GPU
-  un().copyToDevice();
-  WavePatch_Cuda::driverBC(m_numBlkBC, m_idxStep);
-  un().copyToHost();
-#else
-  for (int dir = 0; dir != g_SpaceDim; ++dir)
+  const bool fill = (m_haloValid == 0);
+  if (fill)
     {
-      for (int side = -1; side < 2; side += 2)
-        {
-          Box srcBox(m_domain);
-          srcBox.adjBox(-1, dir, side);
-          Box dstBox(srcBox);
-          dstBox.shift(side, dir);
-          un().copy(dstBox, 0, un(), srcBox, 0, 1);
-        }
-    }
+#ifdef USE_GPU
+      un().copyToDevice();
+      WavePatch_Cuda::driverBC(m_numBlkBC, m_idxStep);
+      un().copyToHost();
 #endif
+      m_haloValid = m_haloDepth;
+    }
+  --m_haloValid;
 
 //--Update solution
 
@@ -179,55 +229,165 @@ WavePatch::advance()
                             factor);
   unp1().copyToHost();
 #else
-  MD_ARRAY_RESTRICT(arrunp1, unp1());
-  MD_ARRAY_RESTRICT(arrun, un());
-  MD_ARRAY_RESTRICT(arrunm1, unm1());
+  if (fill)
+    {
+      // The exchange, the boundary conditions, and the update of each tile
+      // are tasks, so tiles away from the ghost cells are updated while
+      // messages are in flight
+      TaskGraph& graph = m_graphFill[m_idxStep];
+      if (graph.numTask() == 0)
+        {
+          defineFillGraph(graph, factor);
+        }
+      graph.execute();
+    }
+  else
+    {
+      // Threads of the pool share the tiles of all boxes
+      unp1().parallelFor(m_tileSize, [&](const TileIterator& tit)
+        {
+          updateTile(tit, factor);
+        });
+    }
+#endif  /* !GPU */
+
+//--Swap indices (unp1->un, un->unm1)
+
+  advanceStepIndex();
+  ++m_iteration;
+  m_time += m_dt;
+  m_timerAdvance.stop();
+}
+
+#ifndef USE_GPU
+/*--------------------------------------------------------------------*/
+//  Update one tile of unp1()
+/** The tile is grown by m_haloValid on the sides it shares with its
+ *  box to also update the ghost cells needed by the next steps.
+ *  \param[in]  a_tit   Iterator at the tile
+ *  \param[in]  a_factor
+ *                      \f$(c\Delta t/\Delta x)^2/D\f$
+ *//*-----------------------------------------------------------------*/
+
+void
+WavePatch::updateTile(const TileIterator& a_tit, const Real a_factor)
+{
+  updateCells(*a_tit,
+              a_tit.tileBox(m_haloValid),
+              m_idxStepUpdate,
+              m_idxStep,
+              m_idxStepOld,
+              a_factor);
+}
+
+/*--------------------------------------------------------------------*/
+//  Update cells of one box for one step
+/** \param[in]  a_bidx  Index of the box
+ *  \param[in]  a_compBox
+ *                      Cells to update (may include ghost cells)
+ *  \param[in]  a_idxStepUpdate
+ *                      Index of \f$u^{n+1}\f$ (written)
+ *  \param[in]  a_idxStep
+ *                      Index of \f$u^n\f$
+ *  \param[in]  a_idxStepOld
+ *                      Index of \f$u^{n-1}\f$
+ *  \param[in]  a_factor
+ *                      \f$(c\Delta t/\Delta x)^2/D\f$
+ *//*-----------------------------------------------------------------*/
+
+void
+WavePatch::updateCells(const BoxIndex& a_bidx,
+                       const Box&      a_compBox,
+                       const int       a_idxStepUpdate,
+                       const int       a_idxStep,
+                       const int       a_idxStepOld,
+                       const Real      a_factor)
+{
+  const Box& box = m_boxes[a_bidx];
+  MD_ARRAY_RESTRICT(arrunp1, u(a_idxStepUpdate)[a_bidx]);
+  MD_ARRAY_RESTRICT(arrun, u(a_idxStep)[a_bidx]);
+  MD_ARRAY_RESTRICT(arrunm1, u(a_idxStepOld)[a_bidx]);
 
 #ifdef USE_VEX
+  // Cells at a multiple of the vector size from the first interior
+  // cell are aligned.  Cells before the first aligned cell are peeled.
+  const int i0BeginPacked = a_compBox.loVect(0) +
+    ((box.loVect(0) - a_compBox.loVect(0))%VecSz_r + VecSz_r)%VecSz_r;
+  const int vecPacked   =
+    (a_compBox.hiVect(0) + 1 - i0BeginPacked)/VecSz_r;
+  const int i0EndPacked = i0BeginPacked + vecPacked*VecSz_r;
   const __mvr two_vr = _mm_vr(set1)(2.0);
-  const __mvr factor_vr = _mm_vr(set1)(factor);
-  MD_BOXLOOP_PENCIL_OMP(m_domain, i)
+  const __mvr factor_vr = _mm_vr(set1)(a_factor);
+  // The padded layout aligns the start of each pencil so only the
+  // neighbors in the i0 direction need unaligned loads
+  CH_assert(reinterpret_cast<uintptr_t>(&u(a_idxStep)[a_bidx](box.loVect(),
+                                                             0)) %
+            CH_VECLS_ALIGN == 0);
+  MD_BOXLOOP_PENCIL(a_compBox, i)
     {
-      int i0 = m_domain.loVect(0);
-      for (; i0 <= i0EndPacked; i0 += VecSz_r)
+      // Private copies of the views keep their strides in registers
+      // (the vector stores may alias anything shared)
+      MD_CAPTURE_RESTRICT(arrunp1);
+      MD_CAPTURE_RESTRICT(arrun);
+      MD_CAPTURE_RESTRICT(arrunm1);
+      const auto updateCell =
+        [&](const int i0)
         {
-          const __mvr unp1_vr =
-            two_vr*_mm_vr(loadu)(&arrun[MD_IX(i, 0)]) -
-                   _mm_vr(loadu)(&arrunm1[MD_IX(i, 0)]) + factor_vr*
-            MD_DIRSUM([=](const int            a_dir,
+          arrunp1[MD_IX(i, 0)] =
+            2*arrun[MD_IX(i, 0)] - arrunm1[MD_IX(i, 0)] + a_factor*
+            MD_DIRSUM([=](const int a_dir,
                           MD_DECLIX(const int, a_o))
               {
                 MD_CAPTURE_RESTRICT(arrun);
                 return
-                         _mm_vr(loadu)(&arrun[MD_OFFSETIX(i,+,a_o, 0)]) -
-                  two_vr*_mm_vr(loadu)(&arrun[MD_IX(i, 0)]) +
-                         _mm_vr(loadu)(&arrun[MD_OFFSETIX(i,-,a_o, 0)]);
+                    arrun[MD_OFFSETIX(i,+,a_o, 0)] -
+                  2*arrun[MD_IX(i, 0)] +
+                    arrun[MD_OFFSETIX(i,-,a_o, 0)];
               });
-          _mm_vr(storeu)(&arrunp1[MD_IX(i, 0)], unp1_vr);
+        };
+      // Peel cells before the first aligned cell
+      int i0 = a_compBox.loVect(0);
+      for (; i0 < i0BeginPacked; ++i0)
+        {
+          updateCell(i0);
         }
-      // Catch unpacked cells
-      for (; i0 <= m_domain.hiVect(0); ++i0)
+      for (; i0 < i0EndPacked; i0 += VecSz_r)
         {
-          arrunp1[MD_IX(i, 0)] =
-            2*arrun[MD_IX(i, 0)] - arrunm1[MD_IX(i, 0)] + factor*
-            MD_DIRSUM([=](const int a_dir,
+          const __mvr unp1_vr =
+            two_vr*_mm_vr(load)(&arrun[MD_IX(i, 0)]) -
+                   _mm_vr(load)(&arrunm1[MD_IX(i, 0)]) + factor_vr*
+            MD_DIRSUM([=](const int            a_dir,
                           MD_DECLIX(const int, a_o))
               {
                 MD_CAPTURE_RESTRICT(arrun);
+                if (a_dir == 0)
+                  {
+                    return
+                             _mm_vr(loadu)(&arrun[MD_OFFSETIX(i,+,a_o, 0)]) -
+                      two_vr*_mm_vr(load)(&arrun[MD_IX(i, 0)]) +
+                             _mm_vr(loadu)(&arrun[MD_OFFSETIX(i,-,a_o, 0)]);
+                  }
                 return
-                    arrun[MD_OFFSETIX(i,+,a_o, 0)] -
-                  2*arrun[MD_IX(i, 0)] +
-                    arrun[MD_OFFSETIX(i,-,a_o, 0)];
+                         _mm_vr(load)(&arrun[MD_OFFSETIX(i,+,a_o, 0)]) -
+                  two_vr*_mm_vr(load)(&arrun[MD_IX(i, 0)]) +
+                         _mm_vr(load)(&arrun[MD_OFFSETIX(i,-,a_o, 0)]);
               });
+          _mm_vr(store)(&arrunp1[MD_IX(i, 0)], unp1_vr);
+        }
+      // Catch unpacked cells
+      for (; i0 <= a_compBox.hiVect(0); ++i0)
+        {
+          updateCell(i0);
         }
     }
 #else
 
   // Time terms
   {
-    MD_BOXLOOP_OMP(m_domain, i)
+    MD_BOXLOOP(a_compBox, i)
       {
-        arrunp1[MD_IX(i, 0)] = 2*arrun[MD_IX(i, 0)] - arrunm1[MD_IX(i, 0)];
+        arrunp1[MD_IX(i, 0)] =
+          2*arrun[MD_IX(i, 0)] - arrunm1[MD_IX(i, 0)];
       }
   }
 
@@ -235,24 +395,258 @@ WavePatch::advance()
   for (int dir = 0; dir != g_SpaceDim; ++dir)
     {
       const int MD_ID(o, dir);
-      MD_BOXLOOP_OMP(m_domain, i)
+      MD_BOXLOOP(a_compBox, i)
         {
-          arrunp1[MD_IX(i, 0)] += factor*(arrun[MD_OFFSETIX(i,+,o, 0)] -
+          arrunp1[MD_IX(i, 0)] += a_factor*(arrun[MD_OFFSETIX(i,+,o, 0)] -
                                           2*arrun[MD_IX(i, 0)] +
                                           arrun[MD_OFFSETIX(i,-,o, 0)]);
-        }         
+        }
     }
 #endif  /* !VEX */
-#endif  /* !GPU */
+}
 
-//--Swap indices (unp1->un, un->unm1)
+/*--------------------------------------------------------------------*/
+//  Define the tasks of a step that fills the ghost cells
+/** The ghost cells of un() (and unm1() with a deep halo) are exchanged
+ *  and then filled outside the domain for each box.  Each tile is
+ *  updated as soon as the cells its stencil reaches are filled, so
+ *  tiles in the interior of the boxes do not wait at all.  The tasks
+ *  hold the current step indices and the graph must only be executed
+ *  when m_idxStep is the same as now.
+ *  \param[out] a_graph Graph to define
+ *  \param[in]  a_factor
+ *                      \f$(c\Delta t/\Delta x)^2/D\f$
+ *//*-----------------------------------------------------------------*/
 
-  advanceStepIndex();
-  ++m_iteration;
-  m_time += m_dt;
+void
+WavePatch::defineFillGraph(TaskGraph& a_graph, const Real a_factor)
+{
+  a_graph.clear();
+  const int idxStep = m_idxStep;
+  const int idxStepOld = m_idxStepOld;
+  const int numLocalBox = m_boxes.localSize();
+  // unm1 is also needed in the ghost cells with a deep halo.  Both are
+  // exchanged in one round of messages.
+  LevelDataGroup<PatchSolData> group;
+  if (m_haloDepth > 1)
+    {
+      group.add(unm1());
+    }
+  group.add(un());
+  std::vector<int> ghostTask;
+  group.addExchangeTasks(a_graph,
+                         m_copierFill,
+                         std::vector<int>(numLocalBox, -1),
+                         ghostTask);
+  std::vector<int> bcTask(numLocalBox);
+  for (DataIterator dit(m_boxes); dit.ok(); ++dit)
+    {
+      const BoxIndex bidx = *dit;
+      const int ib = bidx.localIndex();
+      bcTask[ib] = a_graph.addTask(
+        [this, bidx, idxStep, idxStepOld]
+        {
+          if (m_haloDepth > 1)
+            {
+              fillBC(idxStepOld, bidx);
+            }
+          fillBC(idxStep, bidx);
+        },
+        TaskPriority::urgent);
+      a_graph.addDependency(bcTask[ib], ghostTask[ib]);
+    }
+  const int numItem = TileIterator::numItem(m_boxes, m_tileSize);
+  for (int item = 0; item != numItem; ++item)
+    {
+      const int task = a_graph.addTask(
+        [this, item, a_factor]
+        {
+          updateTile(TileIterator(m_boxes, m_tileSize, item, item + 1),
+                     a_factor);
+        });
+      // Cells reached by the stencil (m_haloValid will be m_haloDepth - 1)
+      const TileIterator tit(m_boxes, m_tileSize, item, item + 1);
+      Box stencilBox = tit.tileBox(m_haloDepth - 1);
+      stencilBox.grow(1);
+      if (!tit.validBox().contains(stencilBox))
+        {
+          a_graph.addDependency(task, bcTask[(*tit).localIndex()]);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Advance a group of time steps with temporal blocking
+/** Between fills of the ghost cells, boxes are independent since each
+ *  one also computes the ghost cells it needs (see advance()).  Each
+ *  box is thus advanced through all the steps until the next fill
+ *  before moving to the next box (see advanceWavefront), so the
+ *  solution is read from memory once per group of steps instead of
+ *  once per step.  The number of steps blocked is at most the halo
+ *  depth.  Threads of the pool share the boxes.  The result is the
+ *  same as calling advance() a_numIter times.
+ *  \param[in]  a_numIter
+ *                      Number of time steps
+ *//*-----------------------------------------------------------------*/
+
+void
+WavePatch::advanceIterGroup(const int a_numIter)
+{
+  m_timerAdvance.start();
+  const Real factor = std::pow(m_dt*m_c/m_dx, 2)/g_SpaceDim;
+  int numIter = a_numIter;
+  while (numIter > 0)
+    {
+      if (m_haloValid == 0)
+        {
+          fillGhostCells();
+          m_haloValid = m_haloDepth;
+        }
+      const int numStep = std::min(numIter, m_haloValid);
+      un().parallelFor([&](const TileIterator& tit)
+        {
+          advanceWavefront(*tit, numStep, factor);
+        });
+      for (int step = 0; step != numStep; ++step)
+        {
+          advanceStepIndex();
+          m_time += m_dt;
+        }
+      m_haloValid -= numStep;
+      m_iteration += numStep;
+      numIter -= numStep;
+    }
   m_timerAdvance.stop();
 }
 
+/*--------------------------------------------------------------------*/
+//  Fill all ghost cells of un() (and unm1() with a deep halo)
+/** Boxes are given to the threads of the ThreadPool to fill their
+ *  ghost cells outside the domain.  The face copies made by fillBC are
+ *  not threaded on these threads (see BaseFab::copy) so no OpenMP team
+ *  is started next to the pool, even for large boxes.
+ *//*-----------------------------------------------------------------*/
+
+void
+WavePatch::fillGhostCells()
+{
+  LevelDataGroup<PatchSolData> group;
+  if (m_haloDepth > 1)
+    {
+      group.add(unm1());
+    }
+  group.add(un());
+  group.exchange(m_copierFill);
+  un().parallelFor([&](const TileIterator& tit)
+    {
+      if (m_haloDepth > 1)
+        {
+          fillBC(m_idxStepOld, *tit);
+        }
+      fillBC(m_idxStep, *tit);
+    });
+}
+
+/*--------------------------------------------------------------------*/
+//  Advance one box through several steps as a wavefront
+/** Planes normal to the last direction are swept once and, at each
+ *  position of the sweep, every step updates the plane one behind
+ *  the plane of the step before it.  The cells a step reads from the
+ *  step before are thus already computed and still in cache, and a
+ *  plane is only overwritten (the time levels rotate in m_u) after
+ *  the steps reading it are done with it.  Step j updates the box
+ *  grown by m_haloValid - 1 - j.
+ *  \param[in]  a_bidx  Index of the box
+ *  \param[in]  a_numStep
+ *                      Number of steps (<= m_haloValid)
+ *  \param[in]  a_factor
+ *                      \f$(c\Delta t/\Delta x)^2/D\f$
+ *//*-----------------------------------------------------------------*/
+
+void
+WavePatch::advanceWavefront(const BoxIndex& a_bidx,
+                            const int       a_numStep,
+                            const Real      a_factor)
+{
+  CH_assert(a_numStep <= m_haloValid);
+  constexpr int dirSweep = g_SpaceDim - 1;
+  const Box& box = m_boxes[a_bidx];
+  // Index of u^{n+m} is idxLevel[(m + 1) % 3]
+  const int idxLevel[3] = { m_idxStepOld, m_idxStep, m_idxStepUpdate };
+  const int sweepLo = box.loVect(dirSweep) - (m_haloValid - 1);
+  const int sweepHi = box.hiVect(dirSweep) + (m_haloValid - 1);
+  for (int pos = sweepLo; pos <= sweepHi; ++pos)
+    {
+      for (int step = 0; step != a_numStep; ++step)
+        {
+          const int grow = m_haloValid - 1 - step;
+          const int plane = pos - step;
+          // Later steps start further from the sweep position
+          if (plane < box.loVect(dirSweep) - grow) break;
+          Box planeBox(box);
+          planeBox.grow(grow);
+          planeBox.loVect(dirSweep) = plane;
+          planeBox.hiVect(dirSweep) = plane;
+          updateCells(a_bidx,
+                      planeBox,
+                      idxLevel[(step + 2) % 3],
+                      idxLevel[(step + 1) % 3],
+                      idxLevel[step % 3],
+                      a_factor);
+        }
+    }
+}
+#endif  /* !GPU */
+
+/*--------------------------------------------------------------------*/
+//  Fill ghost cells of u outside the domain by reflection
+/** The ghost cell at distance d from the domain boundary takes the
+ *  value of the interior cell at distance d - 1.  Ghost cells inside
+ *  the domain must already be filled by an exchange.  Directions are
+ *  filled in turn and each one spans the ghost cells outside the
+ *  domain already filled in the directions before it, so edges and
+ *  corners are filled too.  Each ghost layer of a face is a single
+ *  BaseFab::copy, which is serial when called from a task or a loop of
+ *  the ThreadPool.
+ *  \param[in]  a_idxStep
+ *                      Index of solution in time to fill
+ *  \param[in]  a_bidx  Index of the box to fill
+ *//*-----------------------------------------------------------------*/
+
+void
+WavePatch::fillBC(const int a_idxStep, const BoxIndex& a_bidx)
+{
+  const Box& box = m_boxes[a_bidx];
+  PatchSolData& fab = u(a_idxStep)[a_bidx];
+  // Domain grown in the directions already filled
+  Box filledBox(m_domain);
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      Box faceBox(box);
+      faceBox.grow(m_haloDepth);
+      faceBox &= filledBox;
+      for (int side = -1; side < 2; side += 2)
+        {
+          if ((side < 0 && box.loVect(dir) != m_domain.loVect(dir)) ||
+              (side > 0 && box.hiVect(dir) != m_domain.hiVect(dir)))
+            {
+              continue;
+            }
+          for (int layer = 1; layer <= m_haloDepth; ++layer)
+            {
+              Box srcBox(faceBox);
+              srcBox.adjBox(-1, dir, side);
+              srcBox.shift(-side*(layer - 1), dir);
+              Box dstBox(faceBox);
+              dstBox.adjBox(-1, dir, side);
+              dstBox.shift(side*layer, dir);
+              fab.copy(dstBox, 0, fab, srcBox, 0, 1);
+            }
+        }
+      filledBox.grow(m_haloDepth, dir);
+    }
+}
+
 /*--------------------------------------------------------------------*/
 //  Advance a group of time steps using GPU
 /** 
@@ -306,7 +700,11 @@ WavePatch::writePlotFile(const int a_idxStep, const int a_iteration) const
 
   // Open the CGNS file
   int indexFile;
+#ifdef USE_MPI
+  cgerr = cgp_open(fileName.str().c_str(), CG_MODE_WRITE, &indexFile);
+#else
   cgerr = cg_open(fileName.str().c_str(), CG_MODE_WRITE, &indexFile);
+#endif
   if (cgerr)
     {
       cg_error_print();
@@ -359,7 +757,11 @@ WavePatch::writePlotFile(const int a_idxStep, const int a_iteration) const
     }
 
   // Close the CGNS file
+#ifdef USE_MPI
+  cgerr = cgp_close(indexFile);
+#else
   cgerr = cg_close(indexFile);
+#endif
 
 #endif  /* CGNS */
   m_timerWrite.stop();
@@ -10,8 +10,6 @@
 #include "CudaFab.H"
 #include "WavePatch_Cuda.H"
 
-template <typename T>
-class BaseFab;
 
 //--Constant memory
 
@@ -16,6 +16,8 @@
 #include "Box.H"
 #include "WavePatch.H"
 #include "Stopwatch.H"
+#include "MemoryTracker.H"
+#include "ThreadPool.H"
 
 #ifdef USE_GPU
 #include "CudaSupport.H"
@@ -30,12 +32,22 @@
 #endif
 
 static const char *const usage =
-  "Usage ./wave [-np x] [h [i]]\n"
-  "  x : number of threads for OpenMP.  You can also use\n"
-  "      'export OMP_NUM_THREADS=x' to use x threads with OpenMP.\n"
+  "Usage ./wave [-np x] [-b b] [-k k] [-t t] [-g] [h [i]]\n"
+  "  x : number of threads for OpenMP and the thread pool running the\n"
+  "      kernels.  You can also use 'export OMP_NUM_THREADS=x'.\n"
+  "  b : maximum box size (divides h, default=h).\n"
+  "  k : depth of the halo.  Ghost cells are filled every k steps and\n"
+  "      computed redundantly in between (k > 0, default=1).\n"
+  "  t : size of the tiles distributed among threads in y and z.  Tiles\n"
+  "      span whole rows in x (t > 0, default=8).\n"
+  " -g : temporal blocking.  Each box is advanced through the k steps\n"
+  "      between fills as a wavefront over its z planes (threads share\n"
+  "      the boxes instead of tiles).  Use a large k and boxes whose\n"
+  "      planes fit in cache (e.g., -k 8 -b 64).\n"
   "  h : domain dimensions in y and z (multiple of 32, default=32).\n"
   "  i : number of iterations (i > 0, default=4000*(h/32)).\n"
-  "\n  Use 'export OMP_PROC_BIND=TRUE' to lock thread affinity in OpenMP.\n";
+  "\n  Threads of the pool are pinned to the CPUs of the process.  Use\n"
+  "  'export OMP_PROC_BIND=TRUE' to lock thread affinity in OpenMP.\n";
 
 //--Prototypes
 
@@ -49,10 +61,13 @@ void writeDotsForBlockIter(const int  a_maxDot,
 
 int main(int argc, const char* argv[])
 {
+  DisjointBoxLayout::initMPI(argc, argv);
+  const bool masterProc = (DisjointBoxLayout::procID() == 0);
   if (argc > 1 && (std::strcmp(argv[1], "-h") == 0 ||
                    std::strcmp(argv[1], "--help") == 0))
     {
-      std::cout << usage;
+      if (masterProc) std::cout << usage;
+      DisjointBoxLayout::finalizeMPI();
       return 0;
     }
   Stopwatch<> timerTotal;
@@ -61,6 +76,10 @@ int main(int argc, const char* argv[])
 //--Input parameters for the run
 
   bool badArg = false;
+  int boxSize_in = 0;  // 0 is h
+  int haloDepth = 1;
+  int tileSize_in = TileIterator::defaultTileSize()[1];
+  bool temporalBlocking = false;
   int iargc = 1;
   while (argc > iargc && argv[iargc][0] == '-')
     {
@@ -74,6 +93,36 @@ int main(int argc, const char* argv[])
 #endif
           iargc += 2;
         }
+      else if (std::strcmp(argv[iargc], "-b") == 0 && argc > iargc + 1)
+        {
+          boxSize_in = std::atoi(argv[iargc+1]);
+          iargc += 2;
+        }
+      else if (std::strcmp(argv[iargc], "-t") == 0 && argc > iargc + 1)
+        {
+          tileSize_in = std::atoi(argv[iargc+1]);
+          iargc += 2;
+        }
+      else if (std::strcmp(argv[iargc], "-g") == 0)
+        {
+#ifdef USE_GPU
+          std::cout << "Temporal blocking is only for the CPU!" << std::endl;
+          badArg = true;
+#else
+          temporalBlocking = true;
+#endif
+          ++iargc;
+        }
+      else if (std::strcmp(argv[iargc], "-k") == 0 && argc > iargc + 1)
+        {
+          haloDepth = std::atoi(argv[iargc+1]);
+          iargc += 2;
+        }
+      else
+        {
+          badArg = true;
+          ++iargc;
+        }
     }
 
   int h_in = 64;  // 32 is baseline
@@ -98,7 +147,8 @@ int main(int argc, const char* argv[])
   }
   if (badArg)
     {
-      std::cout << usage;
+      if (masterProc) std::cout << usage;
+      DisjointBoxLayout::finalizeMPI();
       return 1;
     }
 
@@ -112,68 +162,107 @@ int main(int argc, const char* argv[])
   const int iterBlock = 100*(h/32);
   const int plotFreq = iterBlock;
   const IntVect domainSize(D_DECL(h, h, h));
-  const int boxSize = h;
+  const int boxSize = (boxSize_in == 0) ? h : boxSize_in;
   const Real dx = 1./h;
   const Real c = 1.;
   const Real cfl = 0.125;
+  IntVect tileSize = TileIterator::defaultTileSize();
+  for (int dir = 1; dir != g_SpaceDim; ++dir)
+    {
+      tileSize[dir] = tileSize_in;
+    }
 
 //--Check the parameters
 
   int paramErr = 0;
   if (numIter < 0)
     {
-      std::cout << "Number of iterations must be >= 0!" << std::endl;
+      if (masterProc) std::cout << "Number of iterations must be >= 0!"
+                                << std::endl;
       ++paramErr;
     }
   if (!System::fileExists(plotDir))
     {
-      std::cout << "Directory \'" << plotDir << "\' does not exist!"
-                << std::endl;
+      if (masterProc) std::cout << "Directory \'" << plotDir
+                                << "\' does not exist!" << std::endl;
+      ++paramErr;
+    }
+  if (boxSize <= 0)
+    {
+      if (masterProc) std::cout << "Box size must be > 0!" << std::endl;
+      ++paramErr;
+    }
+  else if (haloDepth <= 0 || haloDepth > boxSize)
+    {
+      if (masterProc) std::cout << "Halo depth must be > 0 and <= box size!"
+                                << std::endl;
+      ++paramErr;
+    }
+  if (tileSize_in <= 0)
+    {
+      if (masterProc) std::cout << "Tile size must be > 0!" << std::endl;
       ++paramErr;
     }
   if (plotFreq <= 0)
     {
-      std::cout << "Plot frequency must be > 0!" << std::endl;
+      if (masterProc) std::cout << "Plot frequency must be > 0!"
+                                << std::endl;
       ++paramErr;
     }
-  for (int dir = 0; dir != g_SpaceDim; ++dir)
+  for (int dir = 0; boxSize > 0 && dir != g_SpaceDim; ++dir)
     {
       if (domainSize[dir] % boxSize != 0)
         {
-          std::cout << "Domain size must be a multiple of boxSize "
-            "(currently set to " << boxSize << ")!" << std::endl;
+          if (masterProc) std::cout << "Domain size must be a multiple of "
+                                       "boxSize (currently set to " << boxSize
+                                    << ")!" << std::endl;
           ++paramErr;
         }
     }
   if (numIter < 0)
     {
-      std::cout << "Number of iterations must be >= 0!" << std::endl;
+      if (masterProc) std::cout << "Number of iterations must be >= 0!"
+                                << std::endl;
       ++paramErr;
     }
   if (paramErr)
     {
-      std::cout << usage;
+      if (masterProc) std::cout << usage;
+      DisjointBoxLayout::finalizeMPI();
       return 1;
     }
 
 //--Write information about the run
 
-  std::cout << std::left << std::setw(40) << "Box size: " << boxSize
-            << std::endl;
-  std::cout << std::left << std::setw(40) << "Iterations: " << numIter
-            << std::endl;
-  std::cout << std::left << std::setw(40) << "Domain: "
-            << Box(IntVect::Zero, domainSize-IntVect::Unit)
-            << std::endl;
-  std::cout << std::left << std::setw(40) << "Plot frequency: "
-            << plotFreq << std::endl;
-  std::cout << std::left << std::setw(40) << "Precision: "
-            << 8*sizeof(Real) << " bits\n";
+  if (masterProc)
+    {
+      std::cout << std::left << std::setw(40) << "Box size: " << boxSize
+                << std::endl;
+      std::cout << std::left << std::setw(40) << "Iterations: " << numIter
+                << std::endl;
+      std::cout << std::left << std::setw(40) << "Domain: "
+                << Box(IntVect::Zero, domainSize-IntVect::Unit)
+                << std::endl;
+      std::cout << std::left << std::setw(40) << "Plot frequency: "
+                << plotFreq << std::endl;
+      std::cout << std::left << std::setw(40) << "Halo depth: "
+                << haloDepth << std::endl;
+      std::cout << std::left << std::setw(40) << "Tile size (y, z): "
+                << tileSize_in << std::endl;
+      std::cout << std::left << std::setw(40) << "Temporal blocking: "
+                << (temporalBlocking ? "yes" : "no") << std::endl;
+      std::cout << std::left << std::setw(40) << "Processes: "
+                << DisjointBoxLayout::numProc() << std::endl;
+      std::cout << std::left << std::setw(40) << "Precision: "
+                << 8*sizeof(Real) << " bits\n";
 #ifdef _OPENMP
-  std::cout << std::left << std::setw(40) << "Parallel OpenMP threads: "
-            << omp_get_max_threads() << std::endl;
+      std::cout << std::left << std::setw(40) << "Parallel OpenMP threads: "
+                << omp_get_max_threads() << std::endl;
 #endif
-  std::cout << std::endl;
+      std::cout << std::left << std::setw(40) << "Thread pool threads: "
+                << ThreadPool::instance().numThread() << std::endl;
+      std::cout << std::endl;
+    }
 
 //--Data structures
 
@@ -183,7 +272,9 @@ int main(int argc, const char* argv[])
                         plotFileBase,
                         c,
                         dx,
-                        cfl);
+                        cfl,
+                        haloDepth,
+                        tileSize);
 
 //--Initialize data
 
@@ -288,6 +379,40 @@ int main(int argc, const char* argv[])
                                 patchSolver.iteration());
       writeOnFirstSingleIter = false;
     }
+#else
+  if (temporalBlocking)
+    {
+      // Groups of iterations between plot files (the last may be shorter)
+      while (patchSolver.iteration() != numIter)
+        {
+          if (numGroupIter == 0 && masterProc)
+            {
+              std::cout << "Time step " << std::setw(6)
+                        << patchSolver.iteration()
+                        << " Old time " << std::scientific
+                        << patchSolver.time() << std::endl;
+            }
+          patchSolver.writePlotFile(patchSolver.currentStepIndex(),
+                                    patchSolver.iteration());
+          const int numIterGroup =
+            std::min(plotFreq, numIter - patchSolver.iteration());
+          patchSolver.advanceIterGroup(numIterGroup);
+          ++numGroupIter;
+          if (masterProc)
+            {
+              writeDotsForBlockIter(maxDot,
+                                    numDot,
+                                    numIterGroup,
+                                    patchSolver.iteration(),
+                                    patchSolver.time());
+            }
+        }
+      if (numGroupIter > 0)
+        {
+          patchSolver.writePlotFile(patchSolver.currentStepIndex(),
+                                    patchSolver.iteration());
+        }
+    }
 #endif
 
 //--Run single iterations
@@ -297,19 +422,22 @@ int main(int argc, const char* argv[])
     {
       if (iter % plotFreq == 0 && writeOnFirstSingleIter)
         {
-          if (numDot != 0)
+          if (masterProc)
             {
-              std::cout << std::endl;
-              numDot = 0;
+              if (numDot != 0)
+                {
+                  std::cout << std::endl;
+                  numDot = 0;
+                }
+              std::cout << "Time step " << std::setw(6)
+                        << patchSolver.iteration()
+                        << " Old time " << std::scientific
+                        << patchSolver.time() << std::endl;
             }
-          std::cout << "Time step " << std::setw(6)
-                    << patchSolver.iteration()
-                    << " Old time " << std::scientific
-                    << patchSolver.time() << std::endl;
           patchSolver.writePlotFile(patchSolver.currentStepIndex(),
                                     patchSolver.iteration());
         }
-      else
+      else if (masterProc)
         {
           std::cout.put('.');
           std::cout.flush();
@@ -332,9 +460,12 @@ int main(int argc, const char* argv[])
     }
   if (numIter != 0)
     {
-      std::cout << "Solution finished " << std::setw(6)
-                << patchSolver.iteration() << " iterations at time "
-                << std::scientific << patchSolver.time() << std::endl;
+      if (masterProc)
+        {
+          std::cout << "Solution finished " << std::setw(6)
+                    << patchSolver.iteration() << " iterations at time "
+                    << std::scientific << patchSolver.time() << std::endl;
+        }
       if (numSingleIter != 0)
         {
           patchSolver.writePlotFile(patchSolver.currentStepIndex(),
@@ -345,29 +476,51 @@ int main(int argc, const char* argv[])
 //--Write some times
 
   timerTotal.stop();
-  std::cout << std::endl;
+  // Time of the slowest process
+  double timeAdvance = patchSolver.m_timerAdvance.time();
+#ifdef USE_MPI
+  MPI_Allreduce(MPI_IN_PLACE, &timeAdvance, 1, MPI_DOUBLE, MPI_MAX,
+                MPI_COMM_WORLD);
+#endif
+  if (masterProc)
+    {
+      std::cout << std::endl;
 #ifdef USE_GPU
-  std::cout << std::left << std::setw(40) << "Time for GPU advance (ms): "
-            << gpuTimeAdvance << std::endl;
-  CU_SAFE_CALL(cudaEventDestroy(cuEvent_iterGroupStart));
-  CU_SAFE_CALL(cudaEventDestroy(cuEvent_iterGroupEnd));
-  std::cout << std::left << std::setw(40) << "Time for GPU copy (ms): "
-            << gpuCopy << std::endl;
-  CU_SAFE_CALL(cudaEventDestroy(cuEvent_copyStart));
-  CU_SAFE_CALL(cudaEventDestroy(cuEvent_copyEnd));
-  std::cout << std::left << std::setw(40) << "Time CPU idle (ms): "
-            << timerIdleCPU.time() << std::endl;
+      std::cout << std::left << std::setw(40) << "Time for GPU advance (ms): "
+                << gpuTimeAdvance << std::endl;
+      CU_SAFE_CALL(cudaEventDestroy(cuEvent_iterGroupStart));
+      CU_SAFE_CALL(cudaEventDestroy(cuEvent_iterGroupEnd));
+      std::cout << std::left << std::setw(40) << "Time for GPU copy (ms): "
+                << gpuCopy << std::endl;
+      CU_SAFE_CALL(cudaEventDestroy(cuEvent_copyStart));
+      CU_SAFE_CALL(cudaEventDestroy(cuEvent_copyEnd));
+      std::cout << std::left << std::setw(40) << "Time CPU idle (ms): "
+                << timerIdleCPU.time() << std::endl;
 #endif
-  std::cout << std::left << std::setw(40) << "Time for CPU advance (ms): "
-            << patchSolver.m_timerAdvance.time() << std::endl;
-  std::cout << std::left << std::setw(40)
-            << "Time for writing plot files (ms): "
-            << patchSolver.m_timerWrite.time() << std::endl;
-  std::cout << std::left << std::setw(40) << "Total run time (ms): "
-            << timerTotal.time() << std::endl;
+      std::cout << std::left << std::setw(40) << "Time for CPU advance (ms): "
+                << timeAdvance << std::endl;
+      // Lattice-site updates per second over the whole domain
+      if (timeAdvance > 0.)
+        {
+          std::cout << std::left << std::setw(40) << "Performance (GLUP/s): "
+                    << (double)domain.size()*patchSolver.iteration()/
+                       (timeAdvance*1.E6) << std::endl;
+        }
+      std::cout << std::left << std::setw(40)
+                << "Time for writing plot files (ms): "
+                << patchSolver.m_timerWrite.time() << std::endl;
+      std::cout << std::left << std::setw(40) << "Total run time (ms): "
+                << timerTotal.time() << std::endl;
+
+//--Memory usage
+
+      std::cout << std::endl;
+      MemoryTracker::report(std::cout);
+    }
 
 //--Done
 
+  DisjointBoxLayout::finalizeMPI();
   return 0;
 }
 
@@ -13,8 +13,20 @@
 #include <iomanip>
 #endif
 
+#include <type_traits>
+#include <algorithm>
+
 #include "BaseFab.H"
 #include "BaseFabMacros.H"
+#include "FabAllocator.H"
+#include "MemoryTracker.H"
+#include "ThreadPool.H"
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#define omp_in_parallel() 0
+#endif
 
 #ifdef DEBUGFAB
   #define FABDBG(x) x
@@ -23,6 +35,142 @@
 #endif
 
 
+/*******************************************************************************
+ *
+ * Copy kernels
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  True if the calling thread may open an OpenMP parallel region
+/** Not from within a parallel region (e.g., an exchange threaded over
+ *  motion items), nor on a thread of the ThreadPool running a loop or
+ *  a task since OpenMP would start a separate team for each of them.
+ *//*-----------------------------------------------------------------*/
+
+static inline bool
+ompAllowed()
+{
+  return !omp_in_parallel() && ThreadPool::threadIndex() < 0;
+}
+
+/*--------------------------------------------------------------------*/
+//  True if a copy of this many elements should be threaded
+/*--------------------------------------------------------------------*/
+
+static inline bool
+copyThreaded(const int a_numElem, const int a_minElem)
+{
+  return (a_numElem >= a_minElem) && ompAllowed();
+}
+
+/*--------------------------------------------------------------------*/
+//  Copy a contiguous block of elements
+/** \param[out] a_dst   Destination
+ *  \param[in]  a_src   Source
+ *  \param[in]  a_num   Number of elements
+ *  \param[in]  a_threaded
+ *                      T - split into chunks among threads
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+static void
+copyBlock(T *const       a_dst,
+          const T *const a_src,
+          const size_t   a_num,
+          const bool     a_threaded)
+{
+  constexpr size_t chunk = 16384;
+  const size_t numChunk = (a_num + chunk - 1)/chunk;
+#pragma omp parallel for default(shared) if(a_threaded)
+  for (size_t iChunk = 0; iChunk < numChunk; ++iChunk)
+    {
+      const size_t begin = iChunk*chunk;
+      std::memcpy(a_dst + begin,
+                  a_src + begin,
+                  std::min(chunk, a_num - begin)*sizeof(T));
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Copy pencils of contiguous elements
+/** A pencil is a row in the first direction for one component.  The
+ *  elements of a pencil must be contiguous in both the source and the
+ *  destination.  Planes of all components are distributed among
+ *  threads in a single parallel region.
+ *  \param[out] a_dst   Destination, first element of the first pencil
+ *  \param[in]  a_dstStride
+ *                      Destination strides (the first is not used)
+ *  \param[in]  a_dstCompStride
+ *                      Destination stride between components
+ *  \param[in]  a_src   Source, first element of the first pencil
+ *  \param[in]  a_srcStride
+ *                      Source strides (the first is not used)
+ *  \param[in]  a_srcCompStride
+ *                      Source stride between components
+ *  \param[in]  a_len   Number of cells in each direction (the first is
+ *                      not used)
+ *  \param[in]  a_pencilLen
+ *                      Number of elements in a pencil
+ *  \param[in]  a_numComp
+ *                      Number of components
+ *  \param[in]  a_threaded
+ *                      T - distribute pencils among threads
+ *//*-----------------------------------------------------------------*/
+
+template <typename T>
+static void
+copyPencils(T *const       a_dst,
+            const IntVect& a_dstStride,
+            const int      a_dstCompStride,
+            const T *const a_src,
+            const IntVect& a_srcStride,
+            const int      a_srcCompStride,
+            const IntVect& a_len,
+            const int      a_pencilLen,
+            const int      a_numComp,
+            const bool     a_threaded)
+{
+  D_TERM(,
+         const int len1 = a_len[1];
+         const int dstStride1 = a_dstStride[1];
+         const int srcStride1 = a_srcStride[1];,
+         const int len2 = a_len[2];
+         const int dstStride2 = a_dstStride[2];
+         const int srcStride2 = a_srcStride[2];)
+  // Planes of all components are distributed among threads
+  const int numPlane = a_numComp*D_SELECT(1, 1, len2);
+#pragma omp parallel for default(shared) if(a_threaded)
+  for (int iPlane = 0; iPlane < numPlane; ++iPlane)
+    {
+      const int ic = iPlane/D_SELECT(1, 1, len2);
+      T* dst = a_dst + (size_t)ic*a_dstCompStride;
+      const T* src = a_src + (size_t)ic*a_srcCompStride;
+      D_TERM(,,
+             const int i2 = iPlane - ic*len2;
+             dst += i2*dstStride2;
+             src += i2*srcStride2;)
+      if (a_pencilLen == 1)
+        {
+          for (int i1 = 0; i1 != D_SELECT(1, len1, len1); ++i1)
+            {
+              dst[i1*D_SELECT(0, dstStride1, dstStride1)] =
+                src[i1*D_SELECT(0, srcStride1, srcStride1)];
+            }
+        }
+      else
+        {
+          for (int i1 = 0; i1 != D_SELECT(1, len1, len1); ++i1)
+            {
+              std::memcpy(dst + i1*D_SELECT(0, dstStride1, dstStride1),
+                          src + i1*D_SELECT(0, srcStride1, srcStride1),
+                          a_pencilLen*sizeof(T));
+            }
+        }
+    }
+}
+
+
 /*******************************************************************************
  *
  * Class BaseFab: member definitions
@@ -33,15 +181,21 @@
 //  Default constructor (no allocation)
 /*--------------------------------------------------------------------*/
 
-template <typename T>
-BaseFab<T>::BaseFab()
+template <typename T, typename Layout>
+BaseFab<T, Layout>::BaseFab()
   :
   m_box(),
   m_stride(IntVect::Zero),
+  m_compStride(0),
+  m_rowOrigin(0),
   m_ncomp(0),
   m_size(0),
+  m_lead(0),
+  m_padding(),
   m_data(nullptr),
-  m_allocBy(AllocBy::none)
+  m_allocBy(AllocBy::none),
+  m_allocator(nullptr),
+  m_memoryOwner(nullptr)
 {
   FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
          << "): default construction\n");
@@ -56,15 +210,12 @@ BaseFab<T>::BaseFab()
  *                      is nullptr
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
-BaseFab<T>::BaseFab(const Box& a_box, const int a_ncomp, T *const a_alias)
+template <typename T, typename Layout>
+BaseFab<T, Layout>::BaseFab(const Box& a_box, const int a_ncomp, T *const a_alias)
+  :
+  BaseFab()
 {
-  m_box = a_box;
-  m_ncomp = a_ncomp;
-  m_data = a_alias;
-  m_allocBy = (a_alias == nullptr) ? AllocBy::array : AllocBy::alias;
-  setStride();
-  allocate();
+  define(a_box, a_ncomp, FabPadding::packed(), a_alias);
   FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
          << "): construction with sizes\n");
 }
@@ -79,35 +230,62 @@ BaseFab<T>::BaseFab(const Box& a_box, const int a_ncomp, T *const a_alias)
  *                      is nullptr
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
-BaseFab<T>::BaseFab(const Box& a_box, const int a_ncomp, const T& a_val, T *const a_alias)
+template <typename T, typename Layout>
+BaseFab<T, Layout>::BaseFab(const Box& a_box, const int a_ncomp, const T& a_val, T *const a_alias)
+  :
+  BaseFab()
 {
-  m_box = a_box;
-  m_ncomp = a_ncomp;
-  m_data = a_alias;
-  m_allocBy = (a_alias == nullptr) ? AllocBy::array : AllocBy::alias;
-  setStride();
-  allocate();
+  define(a_box, a_ncomp, FabPadding::packed(), a_alias);
   setVal(a_val);
   FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
          << "): construction with sizes and default value\n");
 }
 
+/*--------------------------------------------------------------------*/
+//  Constructor with sizes and padding
+/** \param[in]  a_box   Box defining array dimensions
+ *  \param[in]  a_ncomp Number of components
+ *  \param[in]  a_padding
+ *                      Padding of the storage
+ *  \param[in]  a_alias nullptr forces allocation.  Otherwise, memory
+ *                      is aliased to this address.  Default parameter
+ *                      is nullptr
+ *//*-----------------------------------------------------------------*/
+
+template <typename T, typename Layout>
+BaseFab<T, Layout>::BaseFab(const Box&        a_box,
+                    const int         a_ncomp,
+                    const FabPadding& a_padding,
+                    T *const          a_alias)
+  :
+  BaseFab()
+{
+  define(a_box, a_ncomp, a_padding, a_alias);
+  FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
+         << "): construction with sizes and padding\n");
+}
+
 /*--------------------------------------------------------------------*/
 //  Move constructor
 /** Moving BaseFabs built as an alias will cause an error
  *  \param[in]  a_fab   Rvalue RHS
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
-BaseFab<T>::BaseFab(BaseFab&& a_fab) noexcept
+template <typename T, typename Layout>
+BaseFab<T, Layout>::BaseFab(BaseFab&& a_fab) noexcept
   :
   m_box(std::move(a_fab.m_box)),
   m_stride(std::move(a_fab.m_stride)),
+  m_compStride(a_fab.m_compStride),
+  m_rowOrigin(a_fab.m_rowOrigin),
   m_ncomp(a_fab.m_ncomp),
   m_size(a_fab.m_size),
+  m_lead(a_fab.m_lead),
+  m_padding(a_fab.m_padding),
   m_data(a_fab.m_data),
-  m_allocBy(a_fab.m_allocBy)
+  m_allocBy(a_fab.m_allocBy),
+  m_allocator(a_fab.m_allocator),
+  m_memoryOwner(a_fab.m_memoryOwner)
 #ifdef USE_GPU
   ,m_dataSymbol(a_fab.m_dataSymbol)
 #endif
@@ -129,9 +307,9 @@ BaseFab<T>::BaseFab(BaseFab&& a_fab) noexcept
  * \param[in]  a_fab    Rvalue RHS
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
-BaseFab<T>&
-BaseFab<T>::operator=(BaseFab&& a_fab) noexcept
+template <typename T, typename Layout>
+BaseFab<T, Layout>&
+BaseFab<T, Layout>::operator=(BaseFab&& a_fab) noexcept
 {
   //if(this != std::move(&a_fab))
   if(this != &a_fab)
@@ -139,9 +317,16 @@ BaseFab<T>::operator=(BaseFab&& a_fab) noexcept
     deallocate();
     m_box = a_fab.m_box;
     m_stride = a_fab.m_stride;
-    m_ncomp= a_fab.m_ncomp;
+    m_compStride = a_fab.m_compStride;
+    m_rowOrigin = a_fab.m_rowOrigin;
+    m_ncomp = a_fab.m_ncomp;
+    m_size = a_fab.m_size;
+    m_lead = a_fab.m_lead;
+    m_padding = a_fab.m_padding;
     m_data = a_fab.m_data;
     m_allocBy = a_fab.m_allocBy;
+    m_allocator = a_fab.m_allocator;
+    m_memoryOwner = a_fab.m_memoryOwner;
     FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
          << "): move construction\n");
     CH_assert(a_fab.m_allocBy != AllocBy::alias);
@@ -160,18 +345,11 @@ BaseFab<T>::operator=(BaseFab&& a_fab) noexcept
  *                      is nullptr
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::define(const Box& a_box, const int a_ncomp, T *const a_alias)
+BaseFab<T, Layout>::define(const Box& a_box, const int a_ncomp, T *const a_alias)
 {
-  FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
-         << "): define\n");
-  deallocate();
-  m_box = a_box;
-  m_ncomp = a_ncomp;
-  m_data = a_alias;
-  m_allocBy = (a_alias == nullptr) ? AllocBy::array : AllocBy::alias;
-  allocate();
+  define(a_box, a_ncomp, FabPadding::packed(), a_alias);
 }
 
 /*--------------------------------------------------------------------*/
@@ -184,27 +362,49 @@ BaseFab<T>::define(const Box& a_box, const int a_ncomp, T *const a_alias)
  *                      is nullptr
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::define(const Box& a_box, const int a_ncomp,const T& a_val, T *const a_alias)
+BaseFab<T, Layout>::define(const Box& a_box, const int a_ncomp,const T& a_val, T *const a_alias)
+{
+  define(a_box, a_ncomp, FabPadding::packed(), a_alias);
+  setVal(a_val);
+}
+
+/*--------------------------------------------------------------------*/
+//  Weak construction with sizes and padding
+/** \param[in]  a_box   Box defining array dimensions
+ *  \param[in]  a_ncomp Number of components
+ *  \param[in]  a_padding
+ *                      Padding of the storage
+ *  \param[in]  a_alias nullptr forces allocation.  Otherwise, memory
+ *                      is aliased to this address and must hold
+ *                      size() elements.  Default parameter is nullptr
+ *//*-----------------------------------------------------------------*/
+
+template <typename T, typename Layout>
+void
+BaseFab<T, Layout>::define(const Box&        a_box,
+                   const int         a_ncomp,
+                   const FabPadding& a_padding,
+                   T *const          a_alias)
 {
   FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
          << "): define\n");
   deallocate();
   m_box = a_box;
   m_ncomp = a_ncomp;
+  m_padding = a_padding;
   m_data = a_alias;
   m_allocBy = (a_alias == nullptr) ? AllocBy::array : AllocBy::alias;
   allocate();
-  setVal(a_val);
 }
 
 /*--------------------------------------------------------------------*/
 //  Destructor
 /*--------------------------------------------------------------------*/
 
-template <typename T>
-BaseFab<T>::~BaseFab()
+template <typename T, typename Layout>
+BaseFab<T, Layout>::~BaseFab()
 {
   FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
          << "): destructor\n");
@@ -213,35 +413,83 @@ BaseFab<T>::~BaseFab()
 
 /*--------------------------------------------------------------------*/
 //  Assign a constant to all components
-/** \param[in]  a_val   Value to assign
+/** Padding is also assigned.  Planes in the outermost direction are
+ *  distributed among threads with the same OpenMP schedule as
+ *  MD_BOXLOOP_OMP (for each component, within a single parallel
+ *  region, if component-major).  If this is the first time the memory
+ *  is touched, pages are placed on the NUMA domain of the threads that
+ *  will later work on them.  Serial for fewer than s_ompMinElem
+ *  elements, within a parallel region, or on a thread of the
+ *  ThreadPool.
+ *  \param[in]  a_val   Value to assign
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::setVal(const T& a_val)
+BaseFab<T, Layout>::setVal(const T& a_val)
 {
-  T* p = dataPtr(0);
-  for (int n = size(); n--;)
+  const int planeStride = m_stride[g_SpaceDim-1];
+  const bool threaded = copyThreaded(m_size, s_ompMinElem);
+  (void)threaded;
+  if (!Layout::s_cellMajor)
     {
-      *p++ = a_val;
+      const int numPlane = m_compStride/planeStride;
+#pragma omp parallel default(shared) if(threaded)
+      for (int ic = 0; ic != m_ncomp; ++ic)
+        {
+          T *const p = dataPtr(ic);
+#pragma omp for
+          for (int iPlane = 0; iPlane < numPlane; ++iPlane)
+            {
+              std::fill_n(p + iPlane*planeStride, planeStride, a_val);
+            }
+        }
+      return;
+    }
+  const int numPlane = m_size/planeStride;
+#pragma omp parallel for default(shared) if(threaded)
+  for (int iPlane = 0; iPlane < numPlane; ++iPlane)
+    {
+      std::fill_n(m_data + iPlane*planeStride, planeStride, a_val);
     }
 }
 
 /*--------------------------------------------------------------------*/
 //  Assign a constant to a single component
-/** \param[in]  a_icomp Component index
+/** Planes in the outermost direction are distributed among threads
+ *  with the same OpenMP schedule as MD_BOXLOOP_OMP.  If component-
+ *  major, padding is also assigned.  Otherwise, only cells in the box
+ *  are assigned.  Serial for fewer than s_ompMinElem elements, within
+ *  a parallel region, or on a thread of the ThreadPool.
+ *  \param[in]  a_icomp Component index
  *  \param[in]  a_val   Value to assign
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::setVal(const int a_icomp, const T& a_val)
+BaseFab<T, Layout>::setVal(const int a_icomp, const T& a_val)
 {
   CH_assert(a_icomp >= 0 && a_icomp < m_ncomp);
-  T* p = dataPtr(a_icomp);
-  for (int n = m_box.size(); n--;)
+  if (Layout::s_cellMajor)
+    {
+      const bool threaded = copyThreaded(m_box.size(), s_ompMinElem);
+      (void)threaded;
+      MD_ARRAY(arr, *this);
+      MD_BOXLOOP_OMP_IF(m_box, i, threaded)
+        {
+          arr[MD_IX(i, a_icomp)] = a_val;
+        }
+      return;
+    }
+  T *const p = dataPtr(a_icomp);
+  const int planeStride = m_stride[g_SpaceDim-1];
+  const int numPlane = m_compStride/planeStride;
+  const bool threaded = copyThreaded(m_compStride, s_ompMinElem);
+  (void)threaded;
+#pragma omp parallel for default(shared) if(threaded)
+  for (int iPlane = 0; iPlane < numPlane; ++iPlane)
     {
-      *p++ = a_val;
+      std::fill_n(p + iPlane*planeStride, planeStride, a_val);
     }
 }
 
@@ -251,29 +499,26 @@ BaseFab<T>::setVal(const int a_icomp, const T& a_val)
  *  \param[in]  a_src   Source BaseFab
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::copy(const Box&     a_box,
-                 const BaseFab& a_src)
+BaseFab<T, Layout>::copy(const Box&     a_box,
+                         const BaseFab& a_src)
 {
   CH_assert(a_src.ncomp() == m_ncomp);
-  
-  MD_ARRAY_RESTRICT(arrSrc, a_src);
-  MD_ARRAY_RESTRICT(arrDst, *this);
-
-  for (int ic = 0; ic != m_ncomp; ++ic)
-    {
-      MD_BOXLOOP_OMP(a_box, i)
-        {
-          arrDst[MD_IX(i, ic)] = arrSrc[MD_IX(i,ic)];
-        }
-    }
+  if (this == &a_src) return;         // Nothing to do
+  copy(a_box, 0, a_src, a_box, 0, m_ncomp);
 }
 
 
 /*--------------------------------------------------------------------*/
 //  Copy a portion of another BaseFab
-/** \param[in]  a_dstBox
+/** Whole BaseFabs with the same storage are copied as one block and
+ *  contiguous pencils with memcpy.  Other layouts are copied one cell
+ *  at a time.  Copies of fewer than s_ompMinElem elements, or made
+ *  within a parallel region or on a thread of the ThreadPool, are not
+ *  threaded.  The source may be this BaseFab if the regions do not
+ *  overlap.
+ *  \param[in]  a_dstBox
  *                      Region to copy to in this BaseFab
  *  \param[in]  a_dstComp
  *                      Start index for destination components
@@ -284,45 +529,104 @@ BaseFab<T>::copy(const Box&     a_box,
  *                      Start index for source components
  *  \param[in]  a_numComp
  *                      Number of components to copy
- *  \param[in]  a_compFlags
- *                      Components are selectively copied based on the
- *                      bits in a_compFlags.  This is only used for
- *                      components < (number of bits in unsigned,
- *                      normally 32).  The bits flags start at bit 0 =
- *                      dstComp/srcComp.  Default, all components are
- *                      used.
+ *  \param[in]  a_compSet
+ *                      Only the components in the set (indexed as
+ *                      destination components) are copied.  Default,
+ *                      all components are copied.
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::copy(const Box&     a_dstBox,
-                 const int      a_dstComp,
-                 const BaseFab& a_src,
-                 const Box&     a_srcBox,
-                 const int      a_srcComp,
-                 const int      a_numComp,
-                 const unsigned a_compFlags)
+BaseFab<T, Layout>::copy(const Box&     a_dstBox,
+                         const int      a_dstComp,
+                         const BaseFab& a_src,
+                         const Box&     a_srcBox,
+                         const int      a_srcComp,
+                         const int      a_numComp,
+                         const CompSet& a_compSet)
 {
   const IntVect len = a_dstBox.dimensions();
-  CH_assert(this != &a_src);
+  CH_assert(this != &a_src || (Box(a_dstBox) &= a_srcBox).isEmpty());
   CH_assert(len == a_srcBox.dimensions());
   CH_assert(m_box.contains(a_dstBox));
   CH_assert(a_src.box().contains(a_srcBox));
   CH_assert(a_dstComp >= 0 && (a_dstComp + a_numComp) <= m_ncomp);
   CH_assert(a_srcComp >= 0 && (a_srcComp + a_numComp) <= a_src.ncomp());
 
+  const bool allComp =
+    a_compSet.containsAll(a_dstComp, a_dstComp + a_numComp);
+  const int numElem = a_numComp*a_dstBox.size();
+  const bool threaded = copyThreaded(numElem, s_ompMinElem);
+
+  // Whole BaseFabs with the same storage are copied as a block (including
+  // padding)
+  if (allComp && a_dstBox == m_box && a_srcBox == m_box && sameStorage(a_src))
+    {
+      if (!Layout::s_cellMajor)
+        {
+          copyBlock(dataPtr(a_dstComp),
+                    a_src.dataPtr(a_srcComp),
+                    (size_t)a_numComp*m_compStride,
+                    threaded);
+          return;
+        }
+      if (a_numComp == m_ncomp)
+        {
+          copyBlock(m_data, a_src.m_data, m_size, threaded);
+          return;
+        }
+    }
+
+  // Pencils are contiguous for a component-major layout or for all
+  // components of a cell-major layout
+  if (!Layout::s_cellMajor)
+    {
+      for (int ic = 0; ic != a_numComp;)
+        {
+          // Copy runs of selected components
+          if (!a_compSet.contains(ic + a_dstComp))
+            {
+              ++ic;
+              continue;
+            }
+          const int icEnd =
+            a_compSet.runEnd(ic + a_dstComp, a_dstComp + a_numComp) -
+            a_dstComp;
+          copyPencils(&(*this)(a_dstBox.loVect(), ic + a_dstComp),
+                      m_stride, m_compStride,
+                      &a_src(a_srcBox.loVect(), ic + a_srcComp),
+                      a_src.m_stride, a_src.m_compStride,
+                      len, len[0], icEnd - ic,
+                      threaded);
+          ic = icEnd;
+        }
+      return;
+    }
+  if (Layout::s_width == 1 && allComp &&
+      a_numComp == m_ncomp && a_numComp == a_src.m_ncomp)
+    {
+      copyPencils(&(*this)(a_dstBox.loVect(), 0),
+                  m_stride, 0,
+                  &a_src(a_srcBox.loVect(), 0),
+                  a_src.m_stride, 0,
+                  len, len[0]*m_ncomp, 1,
+                  threaded);
+      return;
+    }
+
+  // General
   MD_ARRAY_RESTRICT(arrSrc, a_src);
   MD_ARRAY_RESTRICT(arrDst, *this);
-  IntVect offset = a_srcBox.loVect() - a_dstBox.loVect();
-  for (int ic = 0; ic != a_numComp; ++ic)
+  const IntVect offset = a_srcBox.loVect() - a_dstBox.loVect();
+  MD_BOXLOOP_OMP_IF(a_dstBox, i, threaded)
     {
-      const int iDstC = ic + a_dstComp;
-      if ((iDstC >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1 << iDstC)))
+      for (int ic = 0; ic != a_numComp; ++ic)
         {
-          const int iSrcC = ic + a_srcComp;
-          MD_BOXLOOP_OMP(a_dstBox, i)
+          const int iDstC = ic + a_dstComp;
+          if (a_compSet.contains(iDstC))
             {
-              arrDst[MD_IX(i, iDstC)] = arrSrc[MD_OFFSETIV(i,+,offset, iSrcC)];
+              arrDst[MD_IX(i, iDstC)] =
+                arrSrc[MD_OFFSETIV(i,+,offset, ic + a_srcComp)];
             }
         }
     }
@@ -330,7 +634,10 @@ BaseFab<T>::copy(const Box&     a_dstBox,
 
 /*--------------------------------------------------------------------*/
 //  Linearize data in a region and place in a buffer
-/** \param[out] a_buffer
+/** Component-major pencils are copied with memcpy.  Copies of fewer
+ *  than s_ompMinElem elements, or made within a parallel region or on
+ *  a thread of the ThreadPool, are not threaded.
+ *  \param[out] a_buffer
  *                      Linear buffer filled with data
  *  \param[in]  a_region
  *                      Box describing region to place in buffer
@@ -338,37 +645,71 @@ BaseFab<T>::copy(const Box&     a_dstBox,
  *                      Start of components to add to buffer
  *  \param[in]  a_endComp
  *                      One past last component to replace with buffer
- *  \param[in]  a_compFlags
- *                      Components are selectively copied based on the
- *                      bits in a_compFlags.  This is only used for
- *                      components < (number of bits in unsigned,
- *                      normally 32).  The bits flags start at bit 0 =
- *                      a_startComp.  Default, all components are
- *                      used.
+ *  \param[in]  a_compSet
+ *                      Only the components in the set are placed in
+ *                      the buffer, one after the other.  Default, all
+ *                      components are used.
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::linearOut(void *const    a_buffer,
-                      const Box&     a_region,
-                      const int      a_startComp,
-                      const int      a_endComp,
-                      const unsigned a_compFlags) const
+BaseFab<T, Layout>::linearOut(void *const    a_buffer,
+                              const Box&     a_region,
+                              const int      a_startComp,
+                              const int      a_endComp,
+                              const CompSet& a_compSet) const
 {
   CH_assert(a_buffer != NULL);
   CH_assert(m_box.contains(a_region));
   CH_assert(a_startComp >= 0);
   CH_assert(a_endComp >= a_startComp && a_endComp <= m_ncomp);
 
-  MD_ARRAY_RESTRICT(arr, *this);
+  // Buffer is packed and indexed relative to the region
+  const IntVect& rlo = a_region.loVect();
+  const IntVect rlen = a_region.dimensions();
+  const int regionSize = a_region.size();
+  const int numComp = a_compSet.count(a_startComp, a_endComp);
+  const bool threaded = copyThreaded(numComp*regionSize, s_ompMinElem);
   T* p = static_cast<T*>(a_buffer);
-  for (int ic = a_startComp; ic != a_endComp; ++ic)
+
+  // Pencils of a component-major layout are contiguous
+  if (!Layout::s_cellMajor)
     {
-      if ((ic >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1 << ic)))
+      const IntVect bufStride(D_DECL(1, rlen[0], rlen[0]*rlen[1]));
+      for (int ic = a_startComp; ic != a_endComp;)
         {
-          MD_BOXLOOP_OMP(a_region, i)
+          if (!a_compSet.contains(ic))
             {
-              *p++ = arr[MD_IX(i, ic)];
+              ++ic;
+              continue;
+            }
+          const int icEnd = a_compSet.runEnd(ic, a_endComp);
+          copyPencils(p, bufStride, regionSize,
+                      &(*this)(rlo, ic), m_stride, m_compStride,
+                      rlen, rlen[0], icEnd - ic,
+                      threaded);
+          p += (icEnd - ic)*regionSize;
+          ic = icEnd;
+        }
+      return;
+    }
+
+  // Cell-major layouts are transposed one cell at a time
+  MD_ARRAY_RESTRICT(arr, *this);
+  D_TERM(,
+         const int rstr1 = rlen[0];,
+         const int rstr2 = rlen[0]*rlen[1];)
+  MD_BOXLOOP_OMP_IF(a_region, i, threaded)
+    {
+      T* pCell = p + D_TERM((i0 - rlo[0]),
+                            + (i1 - rlo[1])*rstr1,
+                            + (i2 - rlo[2])*rstr2);
+      for (int ic = a_startComp; ic != a_endComp; ++ic)
+        {
+          if (a_compSet.contains(ic))
+            {
+              *pCell = arr[MD_IX(i, ic)];
+              pCell += regionSize;
             }
         }
     }
@@ -376,7 +717,10 @@ BaseFab<T>::linearOut(void *const    a_buffer,
 
 /*--------------------------------------------------------------------*/
 //  Replace data in a region from a linear buffer
-/** \param[int] a_buffer
+/** Component-major pencils are copied with memcpy.  Copies of fewer
+ *  than s_ompMinElem elements, or made within a parallel region or on
+ *  a thread of the ThreadPool, are not threaded.
+ *  \param[in]  a_buffer
  *                      Linear buffer filled with data
  *  \param[in]  a_region
  *                      Box describing region to replace with buffer
@@ -384,35 +728,70 @@ BaseFab<T>::linearOut(void *const    a_buffer,
  *                      Start of components to replace with buffer
  *  \param[in]  a_endComp
  *                      One past last component to replace with buffer
- *  \param[in]  a_compFlags
- *                      Components are selectively copied based on the
- *                      bits in a_compFlags.  This is only used for
- *                      components < (number of bits in unsigned,
- *                      a_startComp.  Default, all components are
- *                      used.
+ *  \param[in]  a_compSet
+ *                      Only the components in the set are replaced,
+ *                      one after the other from the buffer.  Default,
+ *                      all components are used.
  *//*-----------------------------------------------------------------*/
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::linearIn(const void* const a_buffer,
-                     const Box&     a_region,
-                     const int      a_startComp,
-                     const int      a_endComp,
-                     const unsigned a_compFlags)
+BaseFab<T, Layout>::linearIn(const void* const a_buffer,
+                             const Box&        a_region,
+                             const int         a_startComp,
+                             const int         a_endComp,
+                             const CompSet&    a_compSet)
 {
   CH_assert(a_buffer != NULL);
   CH_assert(m_box.contains(a_region));
   CH_assert(a_startComp >= 0);
   CH_assert(a_endComp >= a_startComp && a_endComp <= m_ncomp);
 
+  // Buffer is packed and indexed relative to the region
+  const IntVect& rlo = a_region.loVect();
+  const IntVect rlen = a_region.dimensions();
+  const int regionSize = a_region.size();
+  const int numComp = a_compSet.count(a_startComp, a_endComp);
+  const bool threaded = copyThreaded(numComp*regionSize, s_ompMinElem);
+  const T* p = static_cast<const T*>(a_buffer);
+
+  // Pencils of a component-major layout are contiguous
+  if (!Layout::s_cellMajor)
+    {
+      const IntVect bufStride(D_DECL(1, rlen[0], rlen[0]*rlen[1]));
+      for (int ic = a_startComp; ic != a_endComp;)
+        {
+          if (!a_compSet.contains(ic))
+            {
+              ++ic;
+              continue;
+            }
+          const int icEnd = a_compSet.runEnd(ic, a_endComp);
+          copyPencils(&(*this)(rlo, ic), m_stride, m_compStride,
+                      p, bufStride, regionSize,
+                      rlen, rlen[0], icEnd - ic,
+                      threaded);
+          p += (icEnd - ic)*regionSize;
+          ic = icEnd;
+        }
+      return;
+    }
+
+  // Cell-major layouts are transposed one cell at a time
   MD_ARRAY_RESTRICT(arr, *this);
-  T* p = (T*)a_buffer;
-  for (int ic = a_startComp; ic != a_endComp; ++ic)
+  D_TERM(,
+         const int rstr1 = rlen[0];,
+         const int rstr2 = rlen[0]*rlen[1];)
+  MD_BOXLOOP_OMP_IF(a_region, i, threaded)
     {
-      if ((ic >= (int)(8*sizeof(unsigned))) || (a_compFlags & (1 << ic)))
+      const T* pCell = p + D_TERM((i0 - rlo[0]),
+                                  + (i1 - rlo[1])*rstr1,
+                                  + (i2 - rlo[2])*rstr2);
+      for (int ic = a_startComp; ic != a_endComp; ++ic)
         {
-          MD_BOXLOOP_OMP(a_region, i)
+          if (a_compSet.contains(ic))
             {
-              arr[MD_IX(i, ic)] = *p++;
+              arr[MD_IX(i, ic)] = *pCell;
+              pCell += regionSize;
             }
         }
     }
@@ -424,9 +803,9 @@ BaseFab<T>::linearIn(const void* const a_buffer,
 //  Copy array to device
 /*--------------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::copyToDevice() const
+BaseFab<T, Layout>::copyToDevice() const
 {
   CU_SAFE_CALL(cudaMemcpy(m_dataSymbol.device,
                           m_dataSymbol.host,
@@ -440,9 +819,9 @@ BaseFab<T>::copyToDevice() const
  *                      Stream index (defaults to default stream)
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 inline void
-BaseFab<T>::copyToDeviceAsync(cudaStream_t a_stream) const
+BaseFab<T, Layout>::copyToDeviceAsync(cudaStream_t a_stream) const
 {
   CU_SAFE_CALL(cudaMemcpyAsync(m_dataSymbol.device,
                                m_dataSymbol.host,
@@ -455,9 +834,9 @@ BaseFab<T>::copyToDeviceAsync(cudaStream_t a_stream) const
 //  Copy array to host
 /*--------------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 inline void
-BaseFab<T>::copyToHost()
+BaseFab<T, Layout>::copyToHost()
 {
   CU_SAFE_CALL(cudaMemcpy(m_dataSymbol.host,
                           m_dataSymbol.device,
@@ -471,9 +850,9 @@ BaseFab<T>::copyToHost()
  *                      Stream index (defaults to default stream)
  *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::copyToHostAsync(cudaStream_t a_stream)
+BaseFab<T, Layout>::copyToHostAsync(cudaStream_t a_stream)
 {
   CU_SAFE_CALL(cudaMemcpyAsync(m_dataSymbol.host,
                                m_dataSymbol.device,
@@ -485,72 +864,197 @@ BaseFab<T>::copyToHostAsync(cudaStream_t a_stream)
 
 /*--------------------------------------------------------------------*/
 //  Set strides
-/*--------------------------------------------------------------------*/
+/** A row holds all the components of the cells in the first direction
+ *  if the layout is cell-major, otherwise a single component.  Cell-
+ *  major layouts store whole blocks of Layout::s_width cells starting
+ *  from the row origin.  With padding, the row stride is rounded up to
+ *  the alignment and any stride that is a multiple of
+ *  FabPadding::s_aliasBytes is increased by an aligned amount in the
+ *  next lower direction.  Every stride remains a multiple of the stride
+ *  in the next lower direction so the storage is still a regular
+ *  array.  Also sets the number of lead elements required to align the
+ *  anchor cell.
+ *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::setStride()
+BaseFab<T, Layout>::setStride()
 {
   const IntVect& lo = m_box.loVect();
   const IntVect& hi = m_box.hiVect();
   CH_assert(lo <= hi);
+  const bool padded = !m_padding.isPacked();
+  const int width = Layout::s_width;
+  const int alignElem = std::max(1, m_padding.align/(int)sizeof(T));
+  // Breaks up strides that map to the same cache sets
+  auto avoidAlias = [](const int a_stride, const int a_inc)
+    {
+      return ((a_stride*sizeof(T)) % FabPadding::s_aliasBytes == 0) ?
+        a_stride + a_inc : a_stride;
+    };
+  // With blocks, the anchor cell starts a block
+  m_rowOrigin = lo[0];
+  if (padded && width > 1)
+    {
+      m_rowOrigin += m_padding.anchor % width;
+      if (m_rowOrigin > lo[0])
+        {
+          m_rowOrigin -= width;
+        }
+    }
   // Set strides
-  D_TERM(m_stride[0] = 1;,
-         m_stride[1] = m_stride[0]*(hi[0] - lo[0] + 1);,
-         m_stride[2] = m_stride[1]*(hi[1] - lo[1] + 1);)
-  // Set size
-  m_size = m_stride[g_SpaceDim-1]*(hi[g_SpaceDim-1] - lo[g_SpaceDim-1] + 1);
-} 
+  int stride;
+  if (Layout::s_cellMajor)
+    {
+      m_stride[0] = width*m_ncomp;
+      stride = ((hi[0] - m_rowOrigin)/width + 1)*m_stride[0];
+    }
+  else
+    {
+      m_stride[0] = 1;
+      stride = hi[0] - lo[0] + 1;
+    }
+  if (padded)
+    {
+      // Rows must also remain a multiple of the block width
+      const int rowAlign = std::max(alignElem, width);
+      stride = ((stride + rowAlign - 1)/rowAlign)*rowAlign;
+      stride = avoidAlias(stride, rowAlign);
+    }
+  for (int dir = 1; dir != g_SpaceDim; ++dir)
+    {
+      m_stride[dir] = stride;
+      int next = stride*(hi[dir] - lo[dir] + 1);
+      if (padded)
+        {
+          next = avoidAlias(next, stride);
+        }
+      stride = next;
+    }
+  // Set component stride and size
+  if (Layout::s_cellMajor)
+    {
+      m_compStride = width;
+      m_size = stride;
+    }
+  else
+    {
+      m_compStride = stride;
+      m_size = m_ncomp*stride;
+    }
+  // Offset so that the anchor cell is aligned
+  const int anchorOffset =
+    Layout::cellOffset(lo[0] + m_padding.anchor - m_rowOrigin, m_stride[0]);
+  m_lead = (padded) ? (alignElem - anchorOffset % alignElem) % alignElem : 0;
+}
 
 /*--------------------------------------------------------------------*/
 //  Allocate memory
-/*--------------------------------------------------------------------*/
+/** Memory is obtained from the current FabAllocator and is aligned to
+ *  at least a cache line.  Any previous memory must already have been
+ *  deallocated.
+ *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::allocate()
+BaseFab<T, Layout>::allocate()
 {
+  static_assert(std::is_trivially_default_constructible<T>::value &&
+                std::is_trivially_destructible<T>::value,
+                "BaseFab memory is not constructed");
+  CH_assert(m_padding.align % sizeof(T) == 0);
+  CH_assert(m_padding.align <= (int)FabAllocator::s_lineAlign);
   setStride();
   if (m_allocBy == AllocBy::array)
     {
-      deallocate();
-#ifdef USE_GPU
       const size_t numBytes = sizeBytes();
+#ifdef USE_GPU
+      CH_assert(m_padding.isPacked());
       CU_SAFE_CALL(cudaMallocHost(&(m_dataSymbol.host), numBytes));
       m_data = m_dataSymbol.host;
       CU_SAFE_CALL(cudaMalloc(&(m_dataSymbol.device), numBytes));
 #else
-      m_data = new T[size()];
+      m_allocator = &FabAllocator::current();
+      m_data = static_cast<T*>(m_allocator->allocate(numBytes)) + m_lead;
 #endif
+      // Only host memory is counted (device memory mirrors it)
+      memoryCategory().add(numBytes);
+      m_memoryOwner = MemoryTracker::owner();
+      if (m_memoryOwner != nullptr) m_memoryOwner->add(numBytes);
       FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
              << "): new\n");
     }
+  else
+    {
+      m_lead = 0;
+    }
 }
 
 /*--------------------------------------------------------------------*/
 //  Deallocate memory
-/*--------------------------------------------------------------------*/
+/** Memory is returned to the FabAllocator that provided it
+ *//*-----------------------------------------------------------------*/
 
-template <typename T>
+template <typename T, typename Layout>
 void
-BaseFab<T>::deallocate()
+BaseFab<T, Layout>::deallocate()
 {
   if (m_allocBy == AllocBy::array && m_data != nullptr)
     {
       FABDBG(std::cout << "BaseFab (" << std::setw(14) << m_data
              << "): delete\n");
+      const size_t numBytes = sizeBytes();
 #ifdef USE_GPU
       CU_SAFE_CALL(cudaFreeHost(m_dataSymbol.host));
       m_dataSymbol.host = nullptr;
       CU_SAFE_CALL(cudaFree(m_dataSymbol.device));
 #else
-      delete[] m_data;
+      m_allocator->deallocate(m_data - m_lead, numBytes);
 #endif
+      memoryCategory().remove(numBytes);
+      if (m_memoryOwner != nullptr) m_memoryOwner->remove(numBytes);
+      m_memoryOwner = nullptr;
       m_data = nullptr;
     }
 }
 
 
+/*--------------------------------------------------------------------*/
+//  Memory used by all BaseFabs of this type
+/*--------------------------------------------------------------------*/
+
+template <typename T, typename Layout>
+MemoryTracker::Category&
+BaseFab<T, Layout>::memoryCategory()
+{
+  static MemoryTracker::Category s_category(s_typeName);
+  return s_category;
+}
+
+
+/*******************************************************************************
+ *
+ * Class BaseFab: names of the instantiations
+ *
+ ******************************************************************************/
+
+template <> const char *const BaseFab<bool>::s_typeName = "BaseFab<bool>";
+template <> const char *const BaseFab<char>::s_typeName = "BaseFab<char>";
+template <> const char *const BaseFab<int>::s_typeName = "BaseFab<int>";
+template <> const char *const BaseFab<unsigned>::s_typeName =
+  "BaseFab<unsigned>";
+template <> const char *const BaseFab<Real>::s_typeName = "BaseFab<Real>";
+template <> const char *const
+BaseFab<Real, FabLayout::CellMajor>::s_typeName =
+  "BaseFab<Real, CellMajor>";
+template <> const char *const
+BaseFab<Real, FabLayout::AoSoA<4> >::s_typeName =
+  "BaseFab<Real, AoSoA<4> >";
+template <> const char *const
+BaseFab<Real, FabLayout::AoSoA<8> >::s_typeName =
+  "BaseFab<Real, AoSoA<8> >";
+
+
 /*******************************************************************************
  *
  * Explicit instantiations of class BaseFab
@@ -562,3 +1066,6 @@ template class BaseFab<char>;
 template class BaseFab<int>;
 template class BaseFab<unsigned>;
 template class BaseFab<Real>;
+template class BaseFab<Real, FabLayout::CellMajor>;
+template class BaseFab<Real, FabLayout::AoSoA<4> >;
+template class BaseFab<Real, FabLayout::AoSoA<8> >;
@@ -8,6 +8,9 @@
  *//*+*************************************************************************/
 
 #include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
 
 #ifdef USE_MPI
 #include <mpi.h>
@@ -33,8 +36,147 @@
  *
  ******************************************************************************/
 
+constexpr int DisjointBoxLayout::s_numNbrCode;
 int DisjointBoxLayout::s_numProc = 1;
 int DisjointBoxLayout::s_procID = 0;
+std::vector<int> DisjointBoxLayout::s_nodeRank(1, 0);
+#ifdef USE_MPI
+MPI_Comm DisjointBoxLayout::s_nodeComm = MPI_COMM_NULL;
+#endif
+
+
+/*******************************************************************************
+ *
+ * Space-filling curves
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Interleave the bits of the coordinates (x in the lowest bit)
+/** \param[in]  a_iv    Coordinates (>= 0)
+ *  \param[in]  a_numBit
+ *                      Bits in each coordinate
+ *  \return             Morton key
+ *//*-----------------------------------------------------------------*/
+
+static std::uint64_t
+mortonKey(const IntVect& a_iv, const int a_numBit)
+{
+  std::uint64_t key = 0;
+  for (int bit = a_numBit - 1; bit >= 0; --bit)
+    {
+      for (int dir = g_SpaceDim - 1; dir >= 0; --dir)
+        {
+          key = (key << 1) | ((a_iv[dir] >> bit) & 1);
+        }
+    }
+  return key;
+}
+
+/*--------------------------------------------------------------------*/
+//  Index along the Hilbert curve
+/** Transforms the coordinates to the transposed Hilbert index with
+ *  Skilling's algorithm (AIP Conf. Proc. 707, 381 (2004)) and then
+ *  interleaves the bits.
+ *  \param[in]  a_iv    Coordinates (>= 0)
+ *  \param[in]  a_numBit
+ *                      Bits in each coordinate
+ *  \return             Hilbert key
+ *//*-----------------------------------------------------------------*/
+
+static std::uint64_t
+hilbertKey(IntVect a_iv, const int a_numBit)
+{
+  const int m = 1 << (a_numBit - 1);
+  // Inverse undo
+  for (int q = m; q > 1; q >>= 1)
+    {
+      const int p = q - 1;
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          if (a_iv[dir] & q)
+            {
+              a_iv[0] ^= p;             // Invert
+            }
+          else
+            {
+              const int t = (a_iv[0] ^ a_iv[dir]) & p;
+              a_iv[0] ^= t;             // Exchange
+              a_iv[dir] ^= t;
+            }
+        }
+    }
+  // Gray encode
+  for (int dir = 1; dir != g_SpaceDim; ++dir)
+    {
+      a_iv[dir] ^= a_iv[dir-1];
+    }
+  int t = 0;
+  for (int q = m; q > 1; q >>= 1)
+    {
+      if (a_iv[g_SpaceDim-1] & q)
+        {
+          t ^= q - 1;
+        }
+    }
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      a_iv[dir] ^= t;
+    }
+  // The transposed index has the most significant bit in direction 0
+  std::uint64_t key = 0;
+  for (int bit = a_numBit - 1; bit >= 0; --bit)
+    {
+      for (int dir = 0; dir != g_SpaceDim; ++dir)
+        {
+          key = (key << 1) | ((a_iv[dir] >> bit) & 1);
+        }
+    }
+  return key;
+}
+
+/*--------------------------------------------------------------------*/
+//  Grid indices of the boxes in a given order
+/** \param[in]  a_numBox
+ *                      Number of boxes in each direction
+ *  \param[in]  a_order Order of the boxes
+ *  \return             Grid index of the boxes, in order
+ *//*-----------------------------------------------------------------*/
+
+static std::vector<int>
+boxOrder(const IntVect& a_numBox, const BoxOrder a_order)
+{
+  const int numBox = a_numBox.product();
+  std::vector<int> order(numBox);
+  std::iota(order.begin(), order.end(), 0);
+  if (a_order == BoxOrder::lexicographic) return order;
+
+  // Curves are defined on a power of 2 cube enclosing the grid of boxes
+  int numBit = 1;
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      while ((1 << numBit) < a_numBox[dir]) ++numBit;
+    }
+  std::vector<std::uint64_t> key(numBox);
+  int gridIdx = 0;
+  D_INVTERM(
+    for (int i = 0; i != a_numBox[0]; ++i)
+      {,
+        for (int j = 0; j != a_numBox[1]; ++j)
+          {,
+            for (int k = 0; k != a_numBox[2]; ++k)
+              {)
+                const IntVect iv(D_DECL(i, j, k));
+                key[gridIdx++] = (a_order == BoxOrder::morton) ?
+                  mortonKey(iv, numBit) : hilbertKey(iv, numBit);
+  D_TERM(},},})
+  std::sort(order.begin(), order.end(),
+            [&key](const int a_i, const int a_j)
+            {
+              return key[a_i] < key[a_j];
+            });
+  return order;
+}
 
 
 /*******************************************************************************
@@ -53,6 +195,8 @@ DisjointBoxLayout::DisjointBoxLayout()
   m_numBox(IntVect::Zero),
   m_size(0),
   m_boxes(),
+  m_linearIdx(),
+  m_nbrTable(),
   m_localIdxBeg(0),
   m_numLocalBox(0)
 {
@@ -63,18 +207,23 @@ DisjointBoxLayout::DisjointBoxLayout()
 /** \param[in] a_domain The problem domain
  *  \param[in] a_maxBoxSize
  *                      Maximum box size in each direction
- *  The problem domain is partitioned into boxes, each having maximum
- *  size in a dimension given by a_maxBoxSize.  Depending on how well
- *  the boxes fit into the domain, either a few boxes have a size
- *  reduced by 1 or there is one box at the end with a significantly
- *  different size.  Leading boxes in each direction usually have
- *  a_maxBoxSize dimensions.
+ *  \param[in] a_order  Order in which boxes are given to the balancer
+ *                      and stored (default lexicographic)
+ *  \param[in] a_balancer
+ *                      Assigns boxes to processes (default contiguous
+ *                      ranges of boxes)
+ *  \param[in] a_cost   Cost of each box in grid order.  If empty
+ *                      (default), the cost is the number of cells.
+ *  See define() for how the domain is partitioned.
  *//*-----------------------------------------------------------------*/
 
-DisjointBoxLayout::DisjointBoxLayout(const Box&     a_domain,
-                                     const IntVect& a_maxBoxSize)
+DisjointBoxLayout::DisjointBoxLayout(const Box&                   a_domain,
+                                     const IntVect&               a_maxBoxSize,
+                                     const BoxOrder               a_order,
+                                     const LoadBalance::Balancer& a_balancer,
+                                     const std::vector<Real>&     a_cost)
 {
-  define(a_domain, a_maxBoxSize);
+  define(a_domain, a_maxBoxSize, a_order, a_balancer, a_cost);
 }
 
 /*--------------------------------------------------------------------*/
@@ -82,28 +231,75 @@ DisjointBoxLayout::DisjointBoxLayout(const Box&     a_domain,
 /** \param[in] a_domain The problem domain
  *  \param[in] a_maxBoxSize
  *                      Maximum box size in each direction
+ *  \param[in] a_order  Order in which boxes are given to the balancer
+ *                      and stored (default lexicographic)
+ *  \param[in] a_balancer
+ *                      Assigns boxes to processes (default contiguous
+ *                      ranges of boxes)
+ *  \param[in] a_cost   Cost of each box in grid order.  If empty
+ *                      (default), the cost is the number of cells.
  *  The problem domain is partitioned into boxes, each having maximum
- *  size in a dimension given by a_maxBoxSize.  Depending on how well
- *  the boxes fit into the domain, either a few boxes have a size
- *  reduced by 1 or there is one box at the end with a significantly
- *  different size.  Leading boxes in each direction usually have
- *  a_maxBoxSize dimensions.
+ *  size in a dimension given by a_maxBoxSize.  If the boxes do not fit
+ *  evenly into the domain, the cells are spread so that boxes differ
+ *  in size by at most 1 and leading boxes in each direction are the
+ *  larger.  The number of boxes need not be a multiple of the number
+ *  of processes.
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::define(const Box&                   a_domain,
+                          const IntVect&               a_maxBoxSize,
+                          const BoxOrder               a_order,
+                          const LoadBalance::Balancer& a_balancer,
+                          const std::vector<Real>&     a_cost)
+{
+  defineForProcs(numProc(), procID(), a_domain, a_maxBoxSize, a_order,
+                 a_balancer, a_cost);
+}
+
+/*--------------------------------------------------------------------*/
+//  Define for a given number of processes
+/** FOR INTERNAL USE AND TESTING ONLY.  This is define() as seen by
+ *  a_procID of a_numProc processes, which allows studying layouts for
+ *  other numbers of processes.  The layout should not be used for
+ *  data unless the arguments are numProc() and procID().
+ *  \param[in] a_numProc
+ *                      Number of processes
+ *  \param[in] a_procID Process for which local boxes are set
+ *  See define() for the other arguments.
  *//*-----------------------------------------------------------------*/
 
 void
-DisjointBoxLayout::define(const Box& a_domain, const IntVect& a_maxBoxSize)
+DisjointBoxLayout::defineForProcs(const int                    a_numProc,
+                                  const int                    a_procID,
+                                  const Box&                   a_domain,
+                                  const IntVect&               a_maxBoxSize,
+                                  const BoxOrder               a_order,
+                                  const LoadBalance::Balancer& a_balancer,
+                                  const std::vector<Real>&     a_cost)
 {
+  CH_assert(a_procID >= 0 && a_procID < a_numProc);
   m_domain = a_domain;
-  const IntVect domainSize =
-    a_domain.hiVect() - a_domain.loVect() + IntVect::Unit;
+  const IntVect domainSize = a_domain.dimensions();
+  CH_assert(IntVect::Zero < a_maxBoxSize);
 
-//--Find the number of boxes in each direction.  They should fit evenly into
-//--the domain.
+//--Find the number of boxes in each direction (rounded up) and the location
+//--of the boxes along each direction
 
-  // The number of boxes in each direction
-  m_numBox = domainSize/a_maxBoxSize;
-  // Make sure the boxes fit evenly into the domain
-  CH_assert(m_numBox*a_maxBoxSize == domainSize);
+  m_numBox = (domainSize + a_maxBoxSize - IntVect::Unit)/a_maxBoxSize;
+  std::vector<int> boxLo[g_SpaceDim];
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      const int numBox = m_numBox[dir];
+      const int baseSize = domainSize[dir]/numBox;
+      const int numLarger = domainSize[dir] - baseSize*numBox;
+      boxLo[dir].resize(numBox + 1);
+      boxLo[dir][0] = a_domain.loVect(dir);
+      for (int i = 0; i != numBox; ++i)
+        {
+          boxLo[dir][i+1] = boxLo[dir][i] + baseSize + (i < numLarger);
+        }
+    }
 
 //--Define the conceptual array of boxes
 
@@ -112,59 +308,99 @@ DisjointBoxLayout::define(const Box& a_domain, const IntVect& a_maxBoxSize)
   D_TERM(m_stride[0] = 1;,
          m_stride[1] = m_stride[0]*m_numBox[0];,
          m_stride[2] = m_stride[1]*m_numBox[1];)
-    m_size = m_stride[g_SpaceDim-1]*m_numBox[g_SpaceDim-1];
-
-  // Allocate the array of boxes
-  m_boxes = std::make_shared<std::vector<BoxEntry> >(m_size);
+  m_size = m_stride[g_SpaceDim-1]*m_numBox[g_SpaceDim-1];
 
-  // Number of boxes per processor
-  const int boxPerProc = m_size/numProc();
-  m_numLocalBox = boxPerProc;
-  m_localIdxBeg = procID()*boxPerProc;
-  // Make sure the boxes fit evenly into the processors
-  CH_assert(m_size == boxPerProc*numProc());
-  
-//--Define the individual boxes and processor assignments for 'm_boxes'
-  int linIdxBox  = 0;
-  //int linIdxProc = 0;
-  IntVect temp_lo = a_domain.loVect();
-  IntVect temp_hi = temp_lo + a_maxBoxSize - IntVect::Unit;
-
-  for(int k = 0; k<numProc();++k)
+  // Boxes in grid order
+  std::vector<Box> gridBoxes(m_size);
   {
-    for(int j = 0; j<boxPerProc;++j)
+    int gridIdx = 0;
+    D_INVTERM(
+      for (int i = 0; i != m_numBox[0]; ++i)
+        {,
+          for (int j = 0; j != m_numBox[1]; ++j)
+            {,
+              for (int k = 0; k != m_numBox[2]; ++k)
+                {)
+                  const IntVect iv(D_DECL(i, j, k));
+                  IntVect lo, hi;
+                  for (int dir = 0; dir != g_SpaceDim; ++dir)
+                    {
+                      lo[dir] = boxLo[dir][iv[dir]];
+                      hi[dir] = boxLo[dir][iv[dir]+1] - 1;
+                    }
+                  gridBoxes[gridIdx++].define(lo, hi);
+    D_TERM(},},})
+  }
+
+//--Assign boxes, in order, to processes
+
+  const std::vector<int> order = boxOrder(m_numBox, a_order);
+  CH_assert(a_cost.empty() || (int)a_cost.size() == m_size);
+  std::vector<Real> cost(m_size);
+  for (int i = 0; i != m_size; ++i)
     {
-      ((*m_boxes)[linIdxBox].box).define(temp_lo, temp_hi);
-      (*m_boxes)[linIdxBox].proc = k;
-      ++linIdxBox;
+      const int gridIdx = order[i];
+      cost[i] = (a_cost.empty()) ? gridBoxes[gridIdx].size() : a_cost[gridIdx];
+    }
+  const std::vector<int> proc = a_balancer(cost, a_numProc);
+  CH_assert((int)proc.size() == m_size);
 
-      if(temp_lo[0]+a_maxBoxSize[0] < a_domain.hiVect(0))
-      {
-        temp_lo[0] += a_maxBoxSize[0];
-        temp_hi[0] += a_maxBoxSize[0];
-      }
-      else if(temp_lo[1] + a_maxBoxSize[1] < a_domain.hiVect(1))
-      {
-        temp_lo[0] = a_domain.loVect(0);
-        temp_hi[0] = a_domain.loVect(0) + a_maxBoxSize[0]-1;
-        temp_lo[1] += a_maxBoxSize[1];
-        temp_hi[1] += a_maxBoxSize[1];
-      }
-      else if(g_SpaceDim == 3)
-      {
-        if(temp_lo[2] + a_maxBoxSize[2] < a_domain.hiVect(2))
-        {
-          temp_lo[0] = a_domain.loVect(0);
-          temp_lo[1] = a_domain.loVect(1);
-          temp_hi[0] = a_domain.loVect(0) + a_maxBoxSize[0]-1;
-          temp_hi[1] = a_domain.loVect(1) + a_maxBoxSize[1]-1;
-          temp_lo[2] += a_maxBoxSize[2];
-          temp_hi[2] += a_maxBoxSize[2];
-        }
-      }
+//--Store the boxes of each process contiguously, in order
 
+  std::vector<int> numProcBox(a_numProc + 1, 0);
+  for (int i = 0; i != m_size; ++i)
+    {
+      CH_assert(proc[i] >= 0 && proc[i] < a_numProc);
+      ++numProcBox[proc[i] + 1];
+    }
+  // Partial sums give the beginning of each process in m_boxes
+  for (int iProc = 0; iProc != a_numProc; ++iProc)
+    {
+      numProcBox[iProc + 1] += numProcBox[iProc];
+    }
+  m_localIdxBeg = numProcBox[a_procID];
+  m_numLocalBox = numProcBox[a_procID + 1] - m_localIdxBeg;
+
+  m_boxes = std::make_shared<std::vector<BoxEntry> >(m_size);
+  m_linearIdx = std::make_shared<std::vector<int> >(m_size);
+  for (int i = 0; i != m_size; ++i)
+    {
+      const int gridIdx = order[i];
+      const int linIdxBox = numProcBox[proc[i]]++;
+      BoxEntry& entry = (*m_boxes)[linIdxBox];
+      entry.box = gridBoxes[gridIdx];
+      entry.proc = proc[i];
+      entry.gridIdx = gridIdx;
+      (*m_linearIdx)[gridIdx] = linIdxBox;
+    }
+
+//--Neighbour table (periodic images wrap)
+
+  m_nbrTable = std::make_shared<std::vector<int> >(m_size*s_numNbrCode);
+  for (int linIdxBox = 0; linIdxBox != m_size; ++linIdxBox)
+    {
+      const IntVect iv = gridIV(linIdxBox);
+      int* const nbr = m_nbrTable->data() + linIdxBox*s_numNbrCode;
+      int nbrCode = 0;
+      D_INVTERM(
+        for (int i = -1; i != 2; ++i)
+          {,
+            for (int j = -1; j != 2; ++j)
+              {,
+                for (int k = -1; k != 2; ++k)
+                  {)
+                    IntVect nbrIV = iv + IntVect(D_DECL(i, j, k));
+                    for (int dir = 0; dir != g_SpaceDim; ++dir)
+                      {
+                        if (nbrIV[dir] < 0) nbrIV[dir] += m_numBox[dir];
+                        if (nbrIV[dir] >= m_numBox[dir])
+                          {
+                            nbrIV[dir] -= m_numBox[dir];
+                          }
+                      }
+                    nbr[nbrCode++] = linearIndex(linearNbrOffset(nbrIV));
+      D_TERM(},},})
     }
-  }
 }
 
 /*--------------------------------------------------------------------*/
@@ -177,14 +413,173 @@ DisjointBoxLayout::define(const Box& a_domain, const IntVect& a_maxBoxSize)
 void
 DisjointBoxLayout::defineDeepCopy(const DisjointBoxLayout& a_dbl)
 {
+  m_domain = a_dbl.m_domain;
   m_stride = a_dbl.m_stride;
   m_numBox = a_dbl.m_numBox;
   m_size = a_dbl.m_size;
-  m_boxes = std::make_shared<std::vector<BoxEntry> >(m_size);
+  m_boxes = std::make_shared<std::vector<BoxEntry> >(*a_dbl.m_boxes);
+  m_linearIdx = std::make_shared<std::vector<int> >(*a_dbl.m_linearIdx);
+  m_nbrTable = std::make_shared<std::vector<int> >(*a_dbl.m_nbrTable);
+  m_localIdxBeg = a_dbl.m_localIdxBeg;
+  m_numLocalBox = a_dbl.m_numLocalBox;
+}
+
+/*--------------------------------------------------------------------*/
+//  Shift of a neighbour across a periodic boundary to its image
+/** \param[in] a_box    A box in the layout
+ *  \param[in] a_nbrDir Direction to the neighbour (components 1, -1,
+ *                      or 0)
+ *  \return             Shift to apply to the neighbour (which is
+ *                      inside the domain) to move it to its periodic
+ *                      image adjacent to a_box.  This is the domain
+ *                      size in the directions where a_box is on the
+ *                      boundary the neighbour is across.
+ *//*-----------------------------------------------------------------*/
+
+IntVect
+DisjointBoxLayout::periodicShift(const Box& a_box, const IntVect& a_nbrDir) const
+{
+  IntVect shift(IntVect::Zero);
+  for (int dir = 0; dir != g_SpaceDim; ++dir)
+    {
+      if ((a_nbrDir[dir] > 0 && a_box.hiVect(dir) == m_domain.hiVect(dir)) ||
+          (a_nbrDir[dir] < 0 && a_box.loVect(dir) == m_domain.loVect(dir)))
+        {
+          shift[dir] = a_nbrDir[dir]*m_domain.dimensions()[dir];
+        }
+    }
+  return shift;
+}
+
+/*--------------------------------------------------------------------*/
+//  Cells of a box with a stencil that does not reach the ghost cells
+/** These cells can be computed between LevelData::exchangeBegin and
+ *  LevelData::exchangeEnd.  The remaining cells are given by
+ *  boundaryBoxes.
+ *  \param[in] a_bidx   Index of a box in the layout
+ *  \param[in] a_stencilRadius
+ *                      Number of cells the stencil reaches from the
+ *                      cell being computed
+ *  \return             The box shrunk by the stencil radius (may be
+ *                      empty)
+ *//*-----------------------------------------------------------------*/
+
+Box
+DisjointBoxLayout::interiorBox(const BoxIndex& a_bidx,
+                               const int       a_stencilRadius) const
+{
+  CH_assert(a_stencilRadius >= 0);
+  Box box(operator[](a_bidx));
+  box.grow(-a_stencilRadius);
+  return box;
+}
+
+/*--------------------------------------------------------------------*/
+//  Cells of a box with a stencil that reaches the ghost cells
+/** The boxes are disjoint slabs, at most two per direction, that
+ *  together with interiorBox cover the box.  Empty slabs are not
+ *  included.
+ *  \param[in] a_bidx   Index of a box in the layout
+ *  \param[in] a_stencilRadius
+ *                      Number of cells the stencil reaches from the
+ *                      cell being computed
+ *  \return             Slabs on the boundary of the box
+ *//*-----------------------------------------------------------------*/
+
+std::vector<Box>
+DisjointBoxLayout::boundaryBoxes(const BoxIndex& a_bidx,
+                                 const int       a_stencilRadius) const
+{
+  CH_assert(a_stencilRadius >= 0);
+  std::vector<Box> slabs;
+  if (a_stencilRadius == 0) return slabs;
+  slabs.reserve(2*g_SpaceDim);
+  // Slabs are removed from the remaining box in each direction
+  Box remaining(operator[](a_bidx));
+  for (int dir = 0; dir != g_SpaceDim && !remaining.isEmpty(); ++dir)
+    {
+      const int width = remaining.dimensions()[dir];
+      const int numLo = std::min(a_stencilRadius, width);
+      Box slab(remaining);
+      slab.hiVect(dir) = remaining.loVect(dir) + numLo - 1;
+      slabs.push_back(slab);
+      remaining.loVect(dir) += numLo;
+      const int numHi = std::min(a_stencilRadius, width - numLo);
+      if (numHi > 0)
+        {
+          slab = remaining;
+          slab.loVect(dir) = remaining.hiVect(dir) - numHi + 1;
+          slabs.push_back(slab);
+          remaining.hiVect(dir) -= numHi;
+        }
+    }
+  return slabs;
+}
+
+/*--------------------------------------------------------------------*/
+//  Communication needed by each process for an exchange
+/** Counts the motion items and ghost cells a Copier defined with the
+ *  same arguments would have each process receive.  All processes
+ *  are computed on every process.
+ *  \param[in] a_numGhost
+ *                      Number of ghost cells
+ *  \param[in] a_periodic
+ *                      Periodic directions (see PeriodicIterator)
+ *  \param[in] a_trim   Trimmed neighbours (see NeighborIterator)
+ *  \return             Volume received by each process
+ *//*-----------------------------------------------------------------*/
+
+std::vector<DisjointBoxLayout::CommVolume>
+DisjointBoxLayout::commVolume(const int      a_numGhost,
+                              const unsigned a_periodic,
+                              const unsigned a_trim) const
+{
+  int numProcLayout = 0;
   for (int i = 0; i != m_size; ++i)
     {
-      getLinear(i) = a_dbl.getLinear(i);
+      numProcLayout = std::max(numProcLayout, getLinear(i).proc + 1);
+    }
+  std::vector<CommVolume> volume(numProcLayout, CommVolume{ 0, 0, 0, 0 });
+  auto addMotion = [&volume](const int a_proc, const int a_nbrProc,
+                             const long long a_numCell)
+    {
+      if (a_numCell == 0) return;
+      CommVolume& vol = volume[a_proc];
+      if (a_nbrProc == a_proc)
+        {
+          ++vol.numLocalMsg;
+          vol.numLocalCell += a_numCell;
+        }
+      else
+        {
+          ++vol.numMsg;
+          vol.numCell += a_numCell;
+        }
+    };
+  for (LayoutIterator lit(*this); lit.ok(); ++lit)
+    {
+      int localProc;
+      const Box& localBox = box(lit, localProc);
+      Box grownBox(localBox);
+      grownBox.grow(a_numGhost);
+      for (NeighborIterator nbrit(lit, a_trim); nbrit.ok(); ++nbrit)
+        {
+          Box region(grownBox);
+          region &= operator[](nbrit);
+          addMotion(localProc, proc(nbrit),
+                    (region.isEmpty()) ? 0 : region.size());
+        }
+      for (PeriodicIterator perit(lit, a_trim, a_periodic); perit.ok();
+           ++perit)
+        {
+          Box remoteBox(operator[](perit));
+          remoteBox.shift(periodicShift(localBox, perit.nbrDir()));
+          remoteBox &= grownBox;
+          addMotion(localProc, proc(perit),
+                    (remoteBox.isEmpty()) ? 0 : remoteBox.size());
+        }
     }
+  return volume;
 }
 
 #ifndef NO_CGNS
@@ -323,6 +718,7 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
       const IntVect loV = box.loVect();
       const IntVect hiV = box.hiVect();
       BaseFab<Real> coords(box, 1);
+      MD_ARRAY_RESTRICT(arrCoords, coords);
 #ifdef USE_MPI
       const int localBoxIndex = (*dit).localIndex();
       CGNSIndices& thisCGNSIndices = localCGNSIndices[localBoxIndex];
@@ -336,10 +732,9 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
 #endif
       // X
       {
-        Real* ptr = coords.dataPtr();
         MD_BOXLOOP_OMP(box,i)
 	{
-		*ptr++ = i0;		
+		arrCoords[MD_IX(i, 0)] = i0;
 	}
 #ifdef USE_MPI
         cgerr = cgp_coord_write_data(a_indexFile, a_indexBase,indexZone,thisCGNSIndices.indexCoord[0], rmin,rmax,coords.dataPtr());
@@ -351,11 +746,10 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
       // Y
       if (g_SpaceDim >= 2)
          {
-          Real* ptr = coords.dataPtr();
 	  MD_BOXLOOP_OMP(box,i)
-	{	
-		*ptr++ = i1;
-	}	
+	{
+		arrCoords[MD_IX(i, 0)] = i1;
+	}
 #ifdef USE_MPI
           cgerr = cgp_coord_write_data(a_indexFile, a_indexBase,indexZone,thisCGNSIndices.indexCoord[1], rmin,rmax,coords.dataPtr());
 #else
@@ -366,10 +760,9 @@ DisjointBoxLayout::writeCGNSZoneGrid(const int      a_indexFile,
       // Z
       if (g_SpaceDim >= 3)
         {
-	Real* ptr = coords.dataPtr();
 	MD_BOXLOOP_OMP(box,i)
 	{
-		*ptr++ = i2;
+		arrCoords[MD_IX(i, 0)] = i2;
 	}
 #ifdef USE_MPI
           cgerr = cgp_coord_write_data(a_indexFile, a_indexBase,indexZone,thisCGNSIndices.indexCoord[2], rmin,rmax,coords.dataPtr());
@@ -398,6 +791,7 @@ DisjointBoxLayout::initMPI(int argc, const char* argv[])
 #ifndef NO_CGNS
   cgp_mpi_comm(MPI_COMM_WORLD);
 #endif
+  defineNodes();
 #endif
 }
 
@@ -411,6 +805,62 @@ void
 DisjointBoxLayout::finalizeMPI()
 {
 #ifdef USE_MPI
+  if (s_nodeComm != MPI_COMM_NULL)
+    {
+      MPI_Comm_free(&s_nodeComm);
+    }
   MPI_Finalize();
 #endif
 }
+
+/*--------------------------------------------------------------------*/
+//  Group processes into nodes that can share memory
+/** Processes are on the same node if they can create a shared-memory
+ *  window (MPI_COMM_TYPE_SHARED).  Called by initMPI with the default
+ *  argument.  This is collective and must not be called while any
+ *  LevelData uses memory shared on the node.
+ *  \param[in]  a_maxNodeProc
+ *                      If > 0, each node is further split into groups
+ *                      of at most this many processes.  This can be
+ *                      used to emulate smaller nodes.  Default 0
+ *                      uses whole nodes.
+ *//*-----------------------------------------------------------------*/
+
+void
+DisjointBoxLayout::defineNodes(const int a_maxNodeProc)
+{
+#ifdef USE_MPI
+  if (s_nodeComm != MPI_COMM_NULL)
+    {
+      MPI_Comm_free(&s_nodeComm);
+    }
+  MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, s_procID,
+                      MPI_INFO_NULL, &s_nodeComm);
+  if (a_maxNodeProc > 0)
+    {
+      int rank;
+      MPI_Comm_rank(s_nodeComm, &rank);
+      MPI_Comm wholeNode = s_nodeComm;
+      MPI_Comm_split(wholeNode, rank/a_maxNodeProc, rank, &s_nodeComm);
+      MPI_Comm_free(&wholeNode);
+    }
+  // Rank of every process in the node communicator
+  MPI_Group worldGroup;
+  MPI_Group nodeGroup;
+  MPI_Comm_group(MPI_COMM_WORLD, &worldGroup);
+  MPI_Comm_group(s_nodeComm, &nodeGroup);
+  std::vector<int> worldRank(s_numProc);
+  std::iota(worldRank.begin(), worldRank.end(), 0);
+  s_nodeRank.resize(s_numProc);
+  MPI_Group_translate_ranks(worldGroup, s_numProc, worldRank.data(),
+                            nodeGroup, s_nodeRank.data());
+  for (int& rank : s_nodeRank)
+    {
+      if (rank == MPI_UNDEFINED) rank = -1;
+    }
+  MPI_Group_free(&nodeGroup);
+  MPI_Group_free(&worldGroup);
+#else
+  (void)a_maxNodeProc;
+#endif
+}
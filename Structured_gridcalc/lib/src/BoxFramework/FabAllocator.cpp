@@ -0,0 +1,482 @@
+
+/******************************************************************************/
+/**
+ * \file FabAllocator.cpp
+ *
+ * \brief Non-inline definitions for classes in FabAllocator.H
+ *
+ *//*+*************************************************************************/
+
+#include <cstdlib>
+#include <new>
+
+#include "FabAllocator.H"
+#include "LinuxSupport.H"
+
+
+/*******************************************************************************
+ *
+ * Class FabAllocator: static member initialization
+ *
+ ******************************************************************************/
+
+FabAllocator* FabAllocator::s_current = nullptr;
+
+
+/*******************************************************************************
+ *
+ * Class FabAllocator: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Return any cached memory to the system
+/** The base class does not cache anything
+ *//*-----------------------------------------------------------------*/
+
+void
+FabAllocator::release()
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Allocator used by newly allocated BaseFabs
+/*--------------------------------------------------------------------*/
+
+FabAllocator&
+FabAllocator::current()
+{
+  return (s_current == nullptr) ? defaultAllocator() : *s_current;
+}
+
+/*--------------------------------------------------------------------*/
+//  Set the allocator used by newly allocated BaseFabs
+/** \param[in]  a_allocator
+ *                      New allocator.  nullptr restores the default.
+ *                      The allocator must outlive all BaseFabs
+ *                      allocated with it.
+ *//*-----------------------------------------------------------------*/
+
+void
+FabAllocator::setCurrent(FabAllocator *const a_allocator)
+{
+  s_current = a_allocator;
+}
+
+/*--------------------------------------------------------------------*/
+//  The default allocator (a PoolAllocator)
+/** The default allocator is never destroyed so that BaseFabs with
+ *  static storage duration can safely return their memory
+ *//*-----------------------------------------------------------------*/
+
+FabAllocator&
+FabAllocator::defaultAllocator()
+{
+  static FabAllocator *const allocator = new PoolAllocator;
+  return *allocator;
+}
+
+/*--------------------------------------------------------------------*/
+//  Alignment used for a block of memory
+/** \param[in]  a_numBytes
+ *                      Size of the block
+ *  \return             Page alignment if the block is at least a
+ *                      page, otherwise cache-line alignment
+ *//*-----------------------------------------------------------------*/
+
+size_t
+FabAllocator::alignment(const size_t a_numBytes)
+{
+  return (a_numBytes >= s_pageAlign) ? s_pageAlign : s_lineAlign;
+}
+
+/*--------------------------------------------------------------------*/
+//  Obtain aligned memory from the system
+/** \param[in]  a_numBytes
+ *                      Size of the block
+ *  \return             Aligned memory
+ *  \throw std::bad_alloc
+ *                      Out of memory
+ *//*-----------------------------------------------------------------*/
+
+void*
+FabAllocator::systemAllocate(const size_t a_numBytes)
+{
+  void* addr = nullptr;
+  if (System::memalign(&addr, alignment(a_numBytes), a_numBytes) != 0)
+    {
+      throw std::bad_alloc();
+    }
+  return addr;
+}
+
+/*--------------------------------------------------------------------*/
+//  Return memory to the system
+/** \param[in]  a_addr  Memory from systemAllocate
+ *//*-----------------------------------------------------------------*/
+
+void
+FabAllocator::systemDeallocate(void *const a_addr)
+{
+  free(a_addr);
+}
+
+
+/*******************************************************************************
+ *
+ * Class AlignedAllocator: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Allocate aligned memory
+/** \param[in]  a_numBytes
+ *                      Number of bytes to allocate
+ *  \return             Aligned memory (nullptr if a_numBytes is 0)
+ *//*-----------------------------------------------------------------*/
+
+void*
+AlignedAllocator::allocate(const size_t a_numBytes)
+{
+  if (a_numBytes == 0)
+    {
+      return nullptr;
+    }
+  return systemAllocate(a_numBytes);
+}
+
+/*--------------------------------------------------------------------*/
+//  Return memory obtained from allocate
+/** \param[in]  a_addr  Memory to return
+ *  \param[in]  a_numBytes
+ *                      Number of bytes requested from allocate
+ *//*-----------------------------------------------------------------*/
+
+void
+AlignedAllocator::deallocate(void *const a_addr, const size_t a_numBytes)
+{
+  systemDeallocate(a_addr);
+}
+
+
+/*******************************************************************************
+ *
+ * Class PoolAllocator: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** \param[in]  a_maxCachedBytes
+ *                      Limit on memory held on the free lists
+ *//*-----------------------------------------------------------------*/
+
+PoolAllocator::PoolAllocator(const size_t a_maxCachedBytes)
+  :
+  m_freeLists(),
+  m_cachedBytes(0),
+  m_maxCachedBytes(a_maxCachedBytes),
+  m_numHits(0),
+  m_numMisses(0)
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor
+/** Memory still in use by BaseFabs is not freed
+ *//*-----------------------------------------------------------------*/
+
+PoolAllocator::~PoolAllocator()
+{
+  release();
+}
+
+/*--------------------------------------------------------------------*/
+//  Allocate aligned memory
+/** \param[in]  a_numBytes
+ *                      Number of bytes to allocate
+ *  \return             Aligned memory of at least sizeClass(a_numBytes)
+ *                      (nullptr if a_numBytes is 0)
+ *//*-----------------------------------------------------------------*/
+
+void*
+PoolAllocator::allocate(const size_t a_numBytes)
+{
+  if (a_numBytes == 0)
+    {
+      return nullptr;
+    }
+  const size_t classBytes = sizeClass(a_numBytes);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto iter = m_freeLists.find(classBytes);
+    if (iter != m_freeLists.end() && !iter->second.empty())
+      {
+        void *const addr = iter->second.back();
+        iter->second.pop_back();
+        m_cachedBytes -= classBytes;
+        ++m_numHits;
+        return addr;
+      }
+    ++m_numMisses;
+  }
+  return systemAllocate(classBytes);
+}
+
+/*--------------------------------------------------------------------*/
+//  Return memory obtained from allocate
+/** \param[in]  a_addr  Memory to return
+ *  \param[in]  a_numBytes
+ *                      Number of bytes requested from allocate
+ *//*-----------------------------------------------------------------*/
+
+void
+PoolAllocator::deallocate(void *const a_addr, const size_t a_numBytes)
+{
+  if (a_addr == nullptr)
+    {
+      return;
+    }
+  const size_t classBytes = sizeClass(a_numBytes);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_cachedBytes + classBytes <= m_maxCachedBytes)
+      {
+        m_freeLists[classBytes].push_back(a_addr);
+        m_cachedBytes += classBytes;
+        return;
+      }
+  }
+  systemDeallocate(a_addr);
+}
+
+/*--------------------------------------------------------------------*/
+//  Return all cached memory to the system
+/*--------------------------------------------------------------------*/
+
+void
+PoolAllocator::release()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& freeList : m_freeLists)
+    {
+      for (void* addr : freeList.second)
+        {
+          systemDeallocate(addr);
+        }
+    }
+  m_freeLists.clear();
+  m_cachedBytes = 0;
+}
+
+/*--------------------------------------------------------------------*/
+//  Size class used for a request
+/** \param[in]  a_numBytes
+ *                      Number of bytes requested
+ *  \return             Number of bytes in the size class
+ *//*-----------------------------------------------------------------*/
+
+size_t
+PoolAllocator::sizeClass(const size_t a_numBytes)
+{
+  if (a_numBytes <= s_pageAlign)
+    {
+      return ((a_numBytes + s_lineAlign - 1)/s_lineAlign)*s_lineAlign;
+    }
+  // Largest power of 2 < a_numBytes, split into 4 classes
+  size_t pow2 = s_pageAlign;
+  while (2*pow2 < a_numBytes)
+    {
+      pow2 *= 2;
+    }
+  const size_t step = pow2/4;
+  return ((a_numBytes + step - 1)/step)*step;
+}
+
+/*--------------------------------------------------------------------*/
+//  Number of bytes currently held on the free lists
+/*--------------------------------------------------------------------*/
+
+size_t
+PoolAllocator::cachedBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_cachedBytes;
+}
+
+/*--------------------------------------------------------------------*/
+//  Maximum number of bytes held on the free lists
+/*--------------------------------------------------------------------*/
+
+size_t
+PoolAllocator::maxCachedBytes() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_maxCachedBytes;
+}
+
+/*--------------------------------------------------------------------*/
+//  Set the maximum number of bytes held on the free lists
+/** Blocks already cached are kept even if the new limit is smaller
+ *  \param[in]  a_maxCachedBytes
+ *                      New limit
+ *//*-----------------------------------------------------------------*/
+
+void
+PoolAllocator::setMaxCachedBytes(const size_t a_maxCachedBytes)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_maxCachedBytes = a_maxCachedBytes;
+}
+
+/*--------------------------------------------------------------------*/
+//  Number of allocations satisfied from the free lists
+/*--------------------------------------------------------------------*/
+
+size_t
+PoolAllocator::numHits() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_numHits;
+}
+
+/*--------------------------------------------------------------------*/
+//  Number of allocations that required memory from the system
+/*--------------------------------------------------------------------*/
+
+size_t
+PoolAllocator::numMisses() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_numMisses;
+}
+
+
+#ifdef USE_MPI
+/*******************************************************************************
+ *
+ * Class SharedWindowAllocator: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** Collective over a_comm.  Segments need not be contiguous so that
+ *  each can be placed near its process.
+ *  \param[in]  a_numBytes
+ *                      Size of the segment of this process.  Sum
+ *                      blockBytes() for every block that will be
+ *                      allocated.
+ *  \param[in]  a_comm  Communicator of processes on one node
+ *//*-----------------------------------------------------------------*/
+
+SharedWindowAllocator::SharedWindowAllocator(const size_t a_numBytes,
+                                             MPI_Comm     a_comm)
+  :
+  m_win(MPI_WIN_NULL),
+  m_base(nullptr),
+  m_numBytes(a_numBytes),
+  m_used(0)
+{
+  MPI_Info info;
+  MPI_Info_create(&info);
+  MPI_Info_set(info, "alloc_shared_noncontig", "true");
+  MPI_Win_allocate_shared((MPI_Aint)a_numBytes, 1, info, a_comm, &m_base,
+                          &m_win);
+  MPI_Info_free(&info);
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, m_win);
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor
+/** Collective over the communicator given to the constructor.  After
+ *  MPI is finalized, the window is simply forgotten.
+ *//*-----------------------------------------------------------------*/
+
+SharedWindowAllocator::~SharedWindowAllocator()
+{
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+  if (!finalized)
+    {
+      MPI_Win_unlock_all(m_win);
+      MPI_Win_free(&m_win);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Allocate aligned memory
+/** \param[in]  a_numBytes
+ *                      Size of the block
+ *  \return             Aligned memory in the segment of this process
+ *  \throw std::bad_alloc
+ *                      The segment is exhausted
+ *//*-----------------------------------------------------------------*/
+
+void*
+SharedWindowAllocator::allocate(const size_t a_numBytes)
+{
+  if (a_numBytes == 0)
+    {
+      return nullptr;
+    }
+  const size_t align = alignment(a_numBytes);
+  const size_t addr = reinterpret_cast<size_t>(m_base) + m_used;
+  const size_t begin = m_used + (align - addr % align) % align;
+  if (begin + a_numBytes > m_numBytes)
+    {
+      throw std::bad_alloc();
+    }
+  m_used = begin + a_numBytes;
+  return m_base + begin;
+}
+
+/*--------------------------------------------------------------------*/
+//  Return memory obtained from allocate
+/** Memory is only returned when the window is freed
+ *//*-----------------------------------------------------------------*/
+
+void
+SharedWindowAllocator::deallocate(void *const a_addr, const size_t a_numBytes)
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Bytes to reserve in the window for a block
+/** \param[in]  a_numBytes
+ *                      Size of the block
+ *  \return             Size including the worst-case alignment
+ *//*-----------------------------------------------------------------*/
+
+size_t
+SharedWindowAllocator::blockBytes(const size_t a_numBytes)
+{
+  return a_numBytes + alignment(a_numBytes);
+}
+
+/*--------------------------------------------------------------------*/
+//  Start of the segment of a process in the communicator
+/** \param[in]  a_rank  Rank of the process in the communicator
+ *  \return             Address of the segment in this process
+ *//*-----------------------------------------------------------------*/
+
+char*
+SharedWindowAllocator::segment(const int a_rank) const
+{
+  MPI_Aint size;
+  int dispUnit;
+  char* base;
+  MPI_Win_shared_query(m_win, a_rank, &size, &dispUnit, &base);
+  return base;
+}
+
+/*--------------------------------------------------------------------*/
+//  Synchronize the public and private copies of the window
+/*--------------------------------------------------------------------*/
+
+void
+SharedWindowAllocator::sync()
+{
+  MPI_Win_sync(m_win);
+}
+#endif
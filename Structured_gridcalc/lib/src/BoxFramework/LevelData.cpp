@@ -29,8 +29,11 @@
 
 #ifndef NO_CGNS
 /*--------------------------------------------------------------------*/
-//  Write CGNS solution data to a file (specialized for BaseFab<Real>)
-/** The CGNS file must be open
+//  Write CGNS solution data to a file (for BaseFab<Real> in any layout)
+/** The CGNS file must be open.  Component-major data is written
+ *  directly from the BaseFab.  Other layouts are first packed into a
+ *  buffer, one component at a time, with linearOut.
+ *  \param[in] a_data  Data to write
  *  \param[in] a_indexFile
  *                      CGNS index of file
  *  \param[in] a_indexBase
@@ -62,16 +65,21 @@ struct CGNSIndices
 };
 }
 
-template<>
-int
-LevelData<BaseFab<Real> >::writeCGNSSolData(
-  const int                a_indexFile,
-  const int                a_indexBase,
-  const int                a_indexZoneOffset,
-  const char *const *const a_varNames) const
+template <typename Layout>
+static int
+writeCGNSFabSolData(const LevelData<BaseFab<Real, Layout> >& a_data,
+                    const int                a_indexFile,
+                    const int                a_indexBase,
+                    const int                a_indexZoneOffset,
+                    const char *const *const a_varNames)
 {
+  const DisjointBoxLayout& dbl = a_data.disjointBoxLayout();
+  const int ncomp = a_data.ncomp();
+  const int nghost = a_data.nghost();
   int cgerr;
-  std::vector<CGNSIndices> localCGNSIndices(m_disjointBoxLayout.localSize());
+  std::vector<CGNSIndices> localCGNSIndices(dbl.localSize());
+  // Packs one component of cell-major layouts
+  std::vector<Real> buffer;
 
 //--These variables describe the shape of the array in the CGNS file.  We only
 //--want to write the core grid.  The min corner of the core grid has index
@@ -93,8 +101,8 @@ LevelData<BaseFab<Real> >::writeCGNSSolData(
  * same information and note use of LayoutIterator
  *- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-  std::vector<int> indexField(ncomp());
-  for (LayoutIterator lit(m_disjointBoxLayout); lit.ok(); ++lit)
+  std::vector<int> indexField(ncomp);
+  for (LayoutIterator lit(dbl); lit.ok(); ++lit)
     {
       const int globalBoxIndex = (*lit).globalIndex();
       const int localBoxIndex  = (*lit).localIndex();
@@ -112,7 +120,7 @@ LevelData<BaseFab<Real> >::writeCGNSSolData(
       // Write the meta-data to a field solution node for each component
       // (user must use SIDS-standard names here)
 #ifdef USE_MPI
-      for (int iComp = 0; iComp != ncomp(); ++iComp)
+      for (int iComp = 0; iComp != ncomp; ++iComp)
         {
           cgp_field_write(a_indexFile,
                           a_indexBase,
@@ -124,12 +132,12 @@ LevelData<BaseFab<Real> >::writeCGNSSolData(
           if (cgerr) return indexZone;
         }
 #endif
-      if (DisjointBoxLayout::procID() == m_disjointBoxLayout.proc(lit))
+      if (DisjointBoxLayout::procID() == dbl.proc(lit))
         {
           CGNSIndices& thisCGNSIndices = localCGNSIndices[localBoxIndex];
           thisCGNSIndices.indexSol = indexSol;
 #ifdef USE_MPI
-          for (int iComp = 0; iComp != ncomp(); ++iComp)
+          for (int iComp = 0; iComp != ncomp; ++iComp)
             {
               thisCGNSIndices.indexField.push_back(indexField[iComp]);
             }
@@ -142,7 +150,7 @@ LevelData<BaseFab<Real> >::writeCGNSSolData(
  * its own information (note use of DataIterator)
  *- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-  for (DataIterator dit(m_disjointBoxLayout); dit.ok(); ++dit)
+  for (DataIterator dit(dbl); dit.ok(); ++dit)
     {
       const int globalBoxIndex = (*dit).globalIndex();
       const int localBoxIndex  = (*dit).localIndex();
@@ -150,21 +158,40 @@ LevelData<BaseFab<Real> >::writeCGNSSolData(
       CGNSIndices& thisCGNSIndices = localCGNSIndices[localBoxIndex];
       // Only write the core grid (not ghost cells).  Indexing in CGNS starts
       // at 1, not 0.
-      const IntVect boxdim = m_disjointBoxLayout[dit].dimensions();
-      const BaseFab<Real>& fab = this->operator[](dit);
+      const IntVect boxdim = dbl[dit].dimensions();
+      const BaseFab<Real, Layout>& fab = a_data[dit];
       const IntVect fabdim = fab.box().dimensions();
       for (int dir = 0; dir != g_SpaceDim; ++dir)
         {
           // The range of the data in the CGNS file (only contains core grid)
           rmin[dir]    = 1;
           rmax[dir]    = boxdim[dir];
-          // The size and range of data in memory
-          memdim[dir]  = fabdim[dir];
-          memrmin[dir] = 1 + m_nghost;
-          memrmax[dir] = memdim[dir] - m_nghost;
+          if (Layout::s_cellMajor)
+            {
+              // The buffer only contains the core grid
+              memdim[dir]  = boxdim[dir];
+              memrmin[dir] = 1;
+              memrmax[dir] = boxdim[dir];
+              continue;
+            }
+          // The size of data in memory is given by the strides (which may
+          // include padding)
+          const int strideNext = (dir == g_SpaceDim - 1) ?
+            fab.getComponentStride() : fab.getStride()[dir + 1];
+          memdim[dir]  = strideNext/fab.getStride()[dir];
+          // The range of data in memory
+          memrmin[dir] = 1 + nghost;
+          memrmax[dir] = fabdim[dir] - nghost;
         }
-      for (int iComp = 0; iComp != ncomp(); ++iComp)
+      for (int iComp = 0; iComp != ncomp; ++iComp)
         {
+          const Real* data = fab.dataPtr(iComp);
+          if (Layout::s_cellMajor)
+            {
+              buffer.resize(dbl[dit].size());
+              fab.linearOut(buffer.data(), dbl[dit], iComp, iComp + 1);
+              data = buffer.data();
+            }
 #if USE_MPI
           cgerr = cgp_field_general_write_data(
             a_indexFile,
@@ -174,7 +201,7 @@ LevelData<BaseFab<Real> >::writeCGNSSolData(
             thisCGNSIndices.indexField[iComp],
             rmin, rmax,
             memnumdim, memdim, memrmin, memrmax,
-            fab.dataPtr(iComp));
+            data);
 #else
           cgerr = cg_field_general_write(
             a_indexFile,
@@ -185,7 +212,7 @@ LevelData<BaseFab<Real> >::writeCGNSSolData(
             a_varNames[iComp],
             rmin, rmax,
             memnumdim, memdim, memrmin, memrmax,
-            fab.dataPtr(iComp),
+            data,
             &indexField[iComp]);
 #endif
           if (cgerr) return indexZone;
@@ -194,4 +221,54 @@ LevelData<BaseFab<Real> >::writeCGNSSolData(
 
   return 0;
 }
+
+//--Specializations for BaseFab<Real> with each instantiated layout
+
+template<>
+int
+LevelData<BaseFab<Real> >::writeCGNSSolData(
+  const int                a_indexFile,
+  const int                a_indexBase,
+  const int                a_indexZoneOffset,
+  const char *const *const a_varNames) const
+{
+  return writeCGNSFabSolData(*this, a_indexFile, a_indexBase,
+                             a_indexZoneOffset, a_varNames);
+}
+
+template<>
+int
+LevelData<BaseFab<Real, FabLayout::CellMajor> >::writeCGNSSolData(
+  const int                a_indexFile,
+  const int                a_indexBase,
+  const int                a_indexZoneOffset,
+  const char *const *const a_varNames) const
+{
+  return writeCGNSFabSolData(*this, a_indexFile, a_indexBase,
+                             a_indexZoneOffset, a_varNames);
+}
+
+template<>
+int
+LevelData<BaseFab<Real, FabLayout::AoSoA<4> > >::writeCGNSSolData(
+  const int                a_indexFile,
+  const int                a_indexBase,
+  const int                a_indexZoneOffset,
+  const char *const *const a_varNames) const
+{
+  return writeCGNSFabSolData(*this, a_indexFile, a_indexBase,
+                             a_indexZoneOffset, a_varNames);
+}
+
+template<>
+int
+LevelData<BaseFab<Real, FabLayout::AoSoA<8> > >::writeCGNSSolData(
+  const int                a_indexFile,
+  const int                a_indexBase,
+  const int                a_indexZoneOffset,
+  const char *const *const a_varNames) const
+{
+  return writeCGNSFabSolData(*this, a_indexFile, a_indexBase,
+                             a_indexZoneOffset, a_varNames);
+}
 #endif  /* CGNS */
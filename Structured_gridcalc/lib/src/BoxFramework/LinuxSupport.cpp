@@ -14,10 +14,12 @@
 // Feature Test Macro for nanosleep
 #define _POSIX_C_SOURCE 199309L
 #include <unistd.h>
+#include <sched.h>
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <time.h>
 #include <cmath>
+#include <cstdio>
 
 #include "LinuxSupport.H"
 
@@ -112,3 +114,74 @@ int System::sleep(const double s)
   req.tv_nsec = static_cast<long>((std::fabs(s) - sec)*1.E9);
   return nanosleep(&req, &rem);
 }
+
+
+/*============================================================================*/
+//  Pin the calling thread to one of the CPUs the process may run on
+/**
+ *  \param[in]  a_idx   Index of the CPU among those in the affinity mask
+ *                      of the calling thread (modulo their number).  A
+ *                      new thread inherits the mask of its creator so
+ *                      threads created by an unpinned thread can be
+ *                      spread over the CPUs of the process with
+ *                      increasing a_idx.
+ *  \return              0 - success
+ *                      -1 - affinity could not be read or set
+ *//*=========================================================================*/
+
+int System::pinThread(const int a_idx)
+{
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed))
+    {
+      return -1;
+    }
+  const int numCPU = CPU_COUNT(&allowed);
+  if (numCPU == 0)
+    {
+      return -1;
+    }
+  int idx = a_idx % numCPU;
+  for (int cpu = 0; cpu != CPU_SETSIZE; ++cpu)
+    {
+      if (CPU_ISSET(cpu, &allowed) && idx-- == 0)
+        {
+          cpu_set_t mask;
+          CPU_ZERO(&mask);
+          CPU_SET(cpu, &mask);
+          // A pid of 0 is the calling thread
+          return sched_setaffinity(0, sizeof(cpu_set_t), &mask);
+        }
+    }
+  return -1;
+}
+
+
+/*============================================================================*/
+//  Number of threads of the process
+/**
+ *  Counts every thread of the OS process, including those started by
+ *  OpenMP.
+ *  \return             > 0 - number of threads
+ *                       -1 - /proc/self/status could not be read
+ *//*=========================================================================*/
+
+int System::numThread()
+{
+  std::FILE *const status = std::fopen("/proc/self/status", "r");
+  if (status == nullptr)
+    {
+      return -1;
+    }
+  int numThread = -1;
+  char line[256];
+  while (std::fgets(line, sizeof(line), status) != nullptr)
+    {
+      if (std::sscanf(line, "Threads: %d", &numThread) == 1)
+        {
+          break;
+        }
+    }
+  std::fclose(status);
+  return numThread;
+}
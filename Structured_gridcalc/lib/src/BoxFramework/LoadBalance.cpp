@@ -0,0 +1,150 @@
+
+/******************************************************************************/
+/**
+ * \file LoadBalance.cpp
+ *
+ * \brief Non-inline definitions for classes in LoadBalance.H
+ *
+ *//*+*************************************************************************/
+
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <utility>
+
+#include "LoadBalance.H"
+
+
+/*******************************************************************************
+ *
+ * Class LoadBalance: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Box i is assigned to process i%numProc
+/** \param[in]  a_cost  Cost of each box (unused)
+ *  \param[in]  a_numProc
+ *                      Number of processes
+ *  \return             Process for each box
+ *//*-----------------------------------------------------------------*/
+
+std::vector<int>
+LoadBalance::roundRobin(const std::vector<Real>& a_cost,
+                        const int                a_numProc)
+{
+  CH_assert(a_numProc > 0);
+  const int numBox = a_cost.size();
+  std::vector<int> proc(numBox);
+  for (int i = 0; i != numBox; ++i)
+    {
+      proc[i] = i % a_numProc;
+    }
+  return proc;
+}
+
+/*--------------------------------------------------------------------*/
+//  Each process gets a contiguous range of boxes with similar cost
+/** A box is assigned to process p if the middle of its cost, in the
+ *  running sum of costs, falls in [p, p+1)*total/numProc.  With equal
+ *  costs, the number of boxes on each process differs by at most 1.
+ *  \param[in]  a_cost  Cost of each box
+ *  \param[in]  a_numProc
+ *                      Number of processes
+ *  \return             Process for each box (non-decreasing)
+ *//*-----------------------------------------------------------------*/
+
+std::vector<int>
+LoadBalance::contiguous(const std::vector<Real>& a_cost,
+                        const int                a_numProc)
+{
+  CH_assert(a_numProc > 0);
+  const int numBox = a_cost.size();
+  std::vector<int> proc(numBox);
+  const Real total = std::accumulate(a_cost.begin(), a_cost.end(), (Real)0);
+  if (!(total > (Real)0))
+    {
+      // No costs, balance the number of boxes
+      for (int i = 0; i != numBox; ++i)
+        {
+          proc[i] = ((long long)i*a_numProc)/numBox;
+        }
+      return proc;
+    }
+  Real sum = 0.;
+  for (int i = 0; i != numBox; ++i)
+    {
+      CH_assert(a_cost[i] >= (Real)0);
+      const Real mid = sum + (Real)0.5*a_cost[i];
+      proc[i] = std::min(a_numProc - 1, (int)(mid*a_numProc/total));
+      sum += a_cost[i];
+    }
+  return proc;
+}
+
+/*--------------------------------------------------------------------*/
+//  Largest boxes first, each to the process with the least cost
+/** Boxes of equal cost are taken in order and processes with equal
+ *  cost are chosen by lowest ID, so the result is the same on all
+ *  processes.
+ *  \param[in]  a_cost  Cost of each box
+ *  \param[in]  a_numProc
+ *                      Number of processes
+ *  \return             Process for each box
+ *//*-----------------------------------------------------------------*/
+
+std::vector<int>
+LoadBalance::costGreedy(const std::vector<Real>& a_cost,
+                        const int                a_numProc)
+{
+  CH_assert(a_numProc > 0);
+  const int numBox = a_cost.size();
+  std::vector<int> order(numBox);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&a_cost](const int a_i, const int a_j)
+                   {
+                     return a_cost[a_i] > a_cost[a_j];
+                   });
+  // Min-heap of (cost, process)
+  using Load = std::pair<Real, int>;
+  std::priority_queue<Load, std::vector<Load>, std::greater<Load> > load;
+  for (int p = 0; p != a_numProc; ++p)
+    {
+      load.emplace((Real)0, p);
+    }
+  std::vector<int> proc(numBox);
+  for (const int i : order)
+    {
+      Load least = load.top();
+      load.pop();
+      proc[i] = least.second;
+      least.first += a_cost[i];
+      load.push(least);
+    }
+  return proc;
+}
+
+/*--------------------------------------------------------------------*/
+//  Total cost assigned to each process
+/** \param[in]  a_cost  Cost of each box
+ *  \param[in]  a_proc  Process for each box
+ *  \param[in]  a_numProc
+ *                      Number of processes
+ *  \return             Sum of the cost of the boxes on each process
+ *//*-----------------------------------------------------------------*/
+
+std::vector<Real>
+LoadBalance::procCost(const std::vector<Real>& a_cost,
+                      const std::vector<int>&  a_proc,
+                      const int                a_numProc)
+{
+  CH_assert(a_cost.size() == a_proc.size());
+  std::vector<Real> cost(a_numProc, (Real)0);
+  for (int i = 0, i_end = a_cost.size(); i != i_end; ++i)
+    {
+      CH_assert(a_proc[i] >= 0 && a_proc[i] < a_numProc);
+      cost[a_proc[i]] += a_cost[i];
+    }
+  return cost;
+}
@@ -0,0 +1,242 @@
+
+/******************************************************************************/
+/**
+ * \file MemoryTracker.cpp
+ *
+ * \brief Non-inline definitions for classes in MemoryTracker.H
+ *
+ *//*+*************************************************************************/
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+
+#include "MemoryTracker.H"
+
+
+/*******************************************************************************
+ *
+ * Registry of categories
+ *
+ ******************************************************************************/
+
+struct Registry
+{
+  std::mutex mutex;                   ///< Guards the list
+  std::vector<const MemoryTracker::Category*> list;
+                                      ///< Registered categories
+};
+
+/// The registry is constructed by the first category so it outlives them
+static Registry& registry()
+{
+  static Registry s_registry;
+  return s_registry;
+}
+
+/// Owner of BaseFabs allocated by this thread
+static thread_local MemoryTracker::Category* t_owner = nullptr;
+
+
+/*******************************************************************************
+ *
+ * Class MemoryTracker::Category: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor
+/** \param[in]  a_name  Name of the category
+ *  \param[in]  a_inTotal
+ *                      T - bytes are added to the total.  Use false
+ *                          for categories that count a subset of
+ *                          other categories.
+ *//*-----------------------------------------------------------------*/
+
+MemoryTracker::Category::Category(const std::string& a_name,
+                                  const bool         a_inTotal)
+  :
+  m_name(a_name),
+  m_inTotal(a_inTotal),
+  m_current(0),
+  m_peak(0)
+{
+  // Construct the total first so that it outlives this category
+  if (m_inTotal)
+    {
+      total();
+    }
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.list.push_back(this);
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor
+/*--------------------------------------------------------------------*/
+
+MemoryTracker::Category::~Category()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.list.erase(std::remove(reg.list.begin(), reg.list.end(), this),
+                 reg.list.end());
+}
+
+/*--------------------------------------------------------------------*/
+//  Add bytes
+/** Thread safe
+ *  \param[in]  a_numBytes
+ *                      Number of bytes
+ *//*-----------------------------------------------------------------*/
+
+void
+MemoryTracker::Category::add(const std::size_t a_numBytes)
+{
+  const std::size_t current =
+    m_current.fetch_add(a_numBytes, std::memory_order_relaxed) + a_numBytes;
+  std::size_t peak = m_peak.load(std::memory_order_relaxed);
+  while (current > peak &&
+         !m_peak.compare_exchange_weak(peak, current,
+                                       std::memory_order_relaxed));
+  if (m_inTotal)
+    {
+      total().add(a_numBytes);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Remove bytes
+/** Thread safe
+ *  \param[in]  a_numBytes
+ *                      Number of bytes
+ *//*-----------------------------------------------------------------*/
+
+void
+MemoryTracker::Category::remove(const std::size_t a_numBytes)
+{
+  m_current.fetch_sub(a_numBytes, std::memory_order_relaxed);
+  if (m_inTotal)
+    {
+      total().remove(a_numBytes);
+    }
+}
+
+
+/*******************************************************************************
+ *
+ * Class MemoryTracker::OwnerScope: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor sets the owner for this thread
+/** \param[in]  a_owner Category also charged for BaseFabs allocated
+ *                      in this scope
+ *//*-----------------------------------------------------------------*/
+
+MemoryTracker::OwnerScope::OwnerScope(Category& a_owner)
+  :
+  m_prevOwner(t_owner)
+{
+  t_owner = &a_owner;
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor restores the previous owner
+/*--------------------------------------------------------------------*/
+
+MemoryTracker::OwnerScope::~OwnerScope()
+{
+  t_owner = m_prevOwner;
+}
+
+
+/*******************************************************************************
+ *
+ * Class MemoryTracker: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Sum of all categories that are part of the total
+/*--------------------------------------------------------------------*/
+
+MemoryTracker::Category&
+MemoryTracker::total()
+{
+  static Category s_total("Total", false);
+  return s_total;
+}
+
+/*--------------------------------------------------------------------*/
+//  Owner category for BaseFabs allocated by this thread
+/** \return             Category or nullptr if none
+ *//*-----------------------------------------------------------------*/
+
+MemoryTracker::Category*
+MemoryTracker::owner()
+{
+  return t_owner;
+}
+
+/*--------------------------------------------------------------------*/
+//  Categories in order of registration
+/** \return             All categories except the total
+ *//*-----------------------------------------------------------------*/
+
+std::vector<const MemoryTracker::Category*>
+MemoryTracker::categories()
+{
+  const Category *const tot = &total();
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  std::vector<const Category*> list;
+  for (const Category* cat : reg.list)
+    {
+      if (cat != tot) list.push_back(cat);
+    }
+  return list;
+}
+
+/*--------------------------------------------------------------------*/
+//  Write a table of current and peak usage
+/** Categories that are not part of the total are listed after the
+ *  total.  Categories that never held memory are not listed.
+ *  \param[in]  a_os    Stream to write to
+ *//*-----------------------------------------------------------------*/
+
+void
+MemoryTracker::report(std::ostream& a_os)
+{
+  constexpr double MiB = 1024.*1024.;
+  const std::vector<const Category*> list = categories();
+  const std::ios_base::fmtflags flags = a_os.flags();
+  const std::streamsize precision = a_os.precision();
+  a_os << std::left << std::setw(40) << "Memory usage (MiB)"
+       << std::right << std::setw(14) << "Current"
+       << std::setw(14) << "Peak" << std::endl;
+  a_os << std::fixed << std::setprecision(2);
+  auto writeLine = [&](const Category& a_cat)
+    {
+      a_os << "  " << std::left << std::setw(38) << a_cat.name()
+           << std::right << std::setw(14) << a_cat.current()/MiB
+           << std::setw(14) << a_cat.peak()/MiB << std::endl;
+    };
+  for (int inTotal = 1; inTotal >= 0; --inTotal)
+    {
+      for (const Category* cat : list)
+        {
+          if (cat->inTotal() == (bool)inTotal && cat->peak() > 0)
+            {
+              writeLine(*cat);
+            }
+        }
+      if (inTotal)
+        {
+          writeLine(total());
+        }
+    }
+  a_os.flags(flags);
+  a_os.precision(precision);
+}
@@ -0,0 +1,199 @@
+
+/******************************************************************************/
+/**
+ * \file TaskGraph.cpp
+ *
+ * \brief Non-inline definitions for classes in TaskGraph.H
+ *
+ *//*+*************************************************************************/
+
+#include "TaskGraph.H"
+#include "ThreadPool.H"
+
+
+/*******************************************************************************
+ *
+ * Class TaskGraph: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Default constructor
+/*--------------------------------------------------------------------*/
+
+TaskGraph::TaskGraph()
+  :
+  m_numDone(0)
+{
+}
+
+/*--------------------------------------------------------------------*/
+//  Add a task
+/** \param[in]  a_func  Work done by the task
+ *  \param[in]  a_priority
+ *                      When and where the task runs once ready
+ *                      (default TaskPriority::normal)
+ *  \return             Index of the task
+ *//*-----------------------------------------------------------------*/
+
+int
+TaskGraph::addTask(TaskFunc a_func, const TaskPriority a_priority)
+{
+  m_task.push_back(Task{ std::move(a_func), a_priority, 0, {} });
+  return m_task.size() - 1;
+}
+
+/*--------------------------------------------------------------------*/
+//  Add a task with no work that joins its dependencies
+/** \return             Index of the task
+ *//*-----------------------------------------------------------------*/
+
+int
+TaskGraph::addJoin()
+{
+  return addTask(TaskFunc{}, TaskPriority::urgent);
+}
+
+/*--------------------------------------------------------------------*/
+//  Make a task depend on another
+/** Dependencies may only be on tasks added before, so the graph has
+ *  no cycles.
+ *  \param[in]  a_task  Task that waits
+ *  \param[in]  a_pred  Task that must be done first.  A negative
+ *                      index is ignored so tasks that do not exist
+ *                      can be given as -1.
+ *//*-----------------------------------------------------------------*/
+
+void
+TaskGraph::addDependency(const int a_task, const int a_pred)
+{
+  if (a_pred < 0) return;
+  CH_assert(a_task < numTask());
+  CH_assert(a_pred < a_task);
+  m_task[a_pred].m_succ.push_back(a_task);
+  ++m_task[a_task].m_numPred;
+}
+
+/*--------------------------------------------------------------------*/
+//  Run all tasks
+/** Returns once all tasks are done.  Call from the main thread and not
+ *  from within a loop of the ThreadPool.
+ *//*-----------------------------------------------------------------*/
+
+void
+TaskGraph::execute()
+{
+  const int nTask = numTask();
+  if (nTask == 0) return;
+  m_numPredLeft.resize(nTask);
+  m_ready.clear();
+  m_readyMaster.clear();
+  m_numDone = 0;
+  for (int iTask = 0; iTask != nTask; ++iTask)
+    {
+      m_numPredLeft[iTask] = m_task[iTask].m_numPred;
+      if (m_numPredLeft[iTask] == 0)
+        {
+          makeReady(iTask);
+        }
+    }
+  ThreadPool::instance().parallel([this](const int a_thread)
+                                  {
+                                    runTasks(a_thread);
+                                  });
+  CH_assert(m_numDone == nTask);
+}
+
+/*--------------------------------------------------------------------*/
+//  Remove all tasks
+/*--------------------------------------------------------------------*/
+
+void
+TaskGraph::clear()
+{
+  m_task.clear();
+  m_numPredLeft.clear();
+}
+
+/*--------------------------------------------------------------------*/
+//  Run ready tasks on one thread until all tasks are done
+/** The master thread (0) runs master tasks first.  Counts of
+ *  dependencies are updated under the lock, which is cheap next to
+ *  tasks of the size of a tile or box.
+ *  \param[in]  a_thread
+ *                      Index of the thread in the ThreadPool
+ *//*-----------------------------------------------------------------*/
+
+void
+TaskGraph::runTasks(const int a_thread)
+{
+  const int nTask = numTask();
+  const bool master = (a_thread == 0);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true)
+    {
+      m_cv.wait(lock,
+                [this, master, nTask]
+                {
+                  return m_numDone == nTask || !m_ready.empty() ||
+                    (master && !m_readyMaster.empty());
+                });
+      if (m_numDone == nTask) return;
+      int task;
+      if (master && !m_readyMaster.empty())
+        {
+          task = m_readyMaster.front();
+          m_readyMaster.pop_front();
+        }
+      else
+        {
+          task = m_ready.front();
+          m_ready.pop_front();
+        }
+      lock.unlock();
+      if (m_task[task].m_func)
+        {
+          m_task[task].m_func();
+        }
+      lock.lock();
+      ++m_numDone;
+      for (const int succ : m_task[task].m_succ)
+        {
+          if (--m_numPredLeft[succ] == 0)
+            {
+              makeReady(succ);
+            }
+        }
+      if (m_numDone == nTask)
+        {
+          m_cv.notify_all();
+        }
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Place a task that became ready in its queue
+/** The lock must be held (or threads not yet started)
+ *  \param[in]  a_task  Index of the task
+ *//*-----------------------------------------------------------------*/
+
+void
+TaskGraph::makeReady(const int a_task)
+{
+  switch (m_task[a_task].m_priority)
+    {
+    case TaskPriority::normal:
+      m_ready.push_back(a_task);
+      m_cv.notify_one();
+      break;
+    case TaskPriority::urgent:
+      m_ready.push_front(a_task);
+      m_cv.notify_one();
+      break;
+    case TaskPriority::master:
+      m_readyMaster.push_back(a_task);
+      // Only the master thread may take it
+      m_cv.notify_all();
+      break;
+    }
+}
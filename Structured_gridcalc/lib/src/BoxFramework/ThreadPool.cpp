@@ -0,0 +1,341 @@
+
+/******************************************************************************/
+/**
+ * \file ThreadPool.cpp
+ *
+ * \brief Non-inline definitions for classes in ThreadPool.H
+ *
+ *//*+*************************************************************************/
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "ThreadPool.H"
+#include "LinuxSupport.H"
+
+
+/*******************************************************************************
+ *
+ * Class ThreadPool: static member initialization
+ *
+ ******************************************************************************/
+
+std::unique_ptr<ThreadPool> ThreadPool::s_instance;
+thread_local int ThreadPool::s_threadIndex = -1;
+
+
+/*******************************************************************************
+ *
+ * Class ThreadPool: member definitions
+ *
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------*/
+//  Constructor starts the threads
+/** \param[in]  a_numThread
+ *                      Number of threads, including the thread that
+ *                      will start the loops
+ *  \param[in]  a_pin   T - pin threads 1 to a_numThread - 1 to the
+ *                          CPUs of the calling thread, in order
+ *//*-----------------------------------------------------------------*/
+
+ThreadPool::ThreadPool(const int a_numThread, const bool a_pin)
+  :
+  m_numThread(a_numThread),
+  m_deque(new WorkDeque[a_numThread]),
+  m_thread(),
+  m_generation(0),
+  m_numBusy(0),
+  m_steal(true),
+  m_stop(false)
+{
+  CH_assert(a_numThread > 0);
+  for (int thread = 0; thread != m_numThread; ++thread)
+    {
+      m_deque[thread].m_job = nullptr;
+      m_deque[thread].m_context = nullptr;
+      m_deque[thread].m_begin = 0;
+      m_deque[thread].m_end = 0;
+    }
+  m_thread.reserve(m_numThread - 1);
+  for (int thread = 1; thread < m_numThread; ++thread)
+    {
+      m_thread.emplace_back(&ThreadPool::threadMain, this, thread, a_pin);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Destructor joins the threads
+/*--------------------------------------------------------------------*/
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cvStart.notify_all();
+  for (std::thread& thread : m_thread)
+    {
+      thread.join();
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  The process-wide pool
+/** Created with defaultNumThread() pinned threads on first use unless
+ *  define() was called before.  Only use from the main thread.
+ *//*-----------------------------------------------------------------*/
+
+ThreadPool&
+ThreadPool::instance()
+{
+  if (!s_instance)
+    {
+      s_instance.reset(new ThreadPool(defaultNumThread(), true));
+    }
+  return *s_instance;
+}
+
+/*--------------------------------------------------------------------*/
+//  Replace the process-wide pool
+/** The threads of any previous pool are joined.  Must not be called
+ *  from within a loop.
+ *  \param[in]  a_numThread
+ *                      Number of threads, including the thread that
+ *                      will start the loops
+ *  \param[in]  a_pin   T - pin the threads to CPUs (default)
+ *//*-----------------------------------------------------------------*/
+
+void
+ThreadPool::define(const int a_numThread, const bool a_pin)
+{
+  CH_assert(s_threadIndex < 0);
+  s_instance.reset();
+  s_instance.reset(new ThreadPool(a_numThread, a_pin));
+}
+
+/*--------------------------------------------------------------------*/
+//  True if the process-wide pool has been created
+/** By define() or the first use of instance()
+ *//*-----------------------------------------------------------------*/
+
+bool
+ThreadPool::isDefined()
+{
+  return (bool)s_instance;
+}
+
+/*--------------------------------------------------------------------*/
+//  Default number of threads
+/** The number of threads OpenMP would use (so OMP_NUM_THREADS applies)
+ *  or, without OpenMP, the number of hardware threads
+ *//*-----------------------------------------------------------------*/
+
+int
+ThreadPool::defaultNumThread()
+{
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  const int numHW = std::thread::hardware_concurrency();
+  return (numHW > 0) ? numHW : 1;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+//  Index of the calling thread in a running loop
+/** \return             Index in [0, numThread()) or -1 if the calling
+ *                      thread is not running items of a loop
+ *//*-----------------------------------------------------------------*/
+
+int
+ThreadPool::threadIndex()
+{
+  return s_threadIndex;
+}
+
+/*--------------------------------------------------------------------*/
+//  Run a loop
+/** Items are split evenly among the deques before waking the threads
+ *  and the calling thread then works as thread 0.  The loop ends once
+ *  every thread has found no more items, so no thread can still be
+ *  stealing when the deques are filled for the next loop.
+ *  \param[in]  a_job   Work applied to ranges of items
+ *  \param[in]  a_context
+ *                      Context given to the job
+ *  \param[in]  a_numItem
+ *                      Number of items
+ *  \param[in]  a_steal T - threads steal items from others once they
+ *                          have none left (default)
+ *                      F - each thread only runs the items it was
+ *                          given
+ *//*-----------------------------------------------------------------*/
+
+void
+ThreadPool::run(const Job  a_job,
+                void*      a_context,
+                const int  a_numItem,
+                const bool a_steal)
+{
+  if (a_numItem <= 0) return;
+  if (m_numThread == 1 || a_numItem == 1 || s_threadIndex >= 0)
+    {
+      a_job(a_context, 0, a_numItem);
+      return;
+    }
+  for (int thread = 0; thread != m_numThread; ++thread)
+    {
+      WorkDeque& deque = m_deque[thread];
+      std::lock_guard<std::mutex> lock(deque.m_mutex);
+      deque.m_job = a_job;
+      deque.m_context = a_context;
+      deque.m_begin = (int)(((long long)a_numItem*thread)/m_numThread);
+      deque.m_end = (int)(((long long)a_numItem*(thread + 1))/m_numThread);
+    }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    m_numBusy = m_numThread - 1;
+    m_steal = a_steal;
+  }
+  m_cvStart.notify_all();
+  s_threadIndex = 0;
+  work(0);
+  s_threadIndex = -1;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cvDone.wait(lock, [this] { return m_numBusy == 0; });
+}
+
+/*--------------------------------------------------------------------*/
+//  Take and run items until none are left
+/** A thread only returns once its own deque is empty and it found
+ *  nothing to steal.  Items taken by other threads may still be
+ *  running.
+ *  \param[in]  a_thread
+ *                      Index of the calling thread
+ *//*-----------------------------------------------------------------*/
+
+void
+ThreadPool::work(const int a_thread)
+{
+  Job job;
+  void* context;
+  int item;
+  while (take(a_thread, job, context, item) ||
+         (m_steal && steal(a_thread, job, context, item)))
+    {
+      job(context, item, item + 1);
+    }
+}
+
+/*--------------------------------------------------------------------*/
+//  Take an item from the front of a thread's own deque
+/** \param[in]  a_thread
+ *                      Index of the calling thread
+ *  \param[out] a_job   Work to apply to the item
+ *  \param[out] a_context
+ *                      Context for the work
+ *  \param[out] a_item  The item
+ *  \return             T - an item was taken
+ *//*-----------------------------------------------------------------*/
+
+bool
+ThreadPool::take(const int a_thread,
+                 Job&      a_job,
+                 void*&    a_context,
+                 int&      a_item)
+{
+  WorkDeque& deque = m_deque[a_thread];
+  std::lock_guard<std::mutex> lock(deque.m_mutex);
+  if (deque.m_begin == deque.m_end) return false;
+  a_job = deque.m_job;
+  a_context = deque.m_context;
+  a_item = deque.m_begin++;
+  return true;
+}
+
+/*--------------------------------------------------------------------*/
+//  Steal the back half of the deque of another thread
+/** Victims are tried in order after the calling thread.  The first
+ *  stolen item is returned and the rest are placed in the (empty)
+ *  deque of the calling thread, where they may be stolen again.
+ *  \param[in]  a_thread
+ *                      Index of the calling thread
+ *  \param[out] a_job   Work to apply to the item
+ *  \param[out] a_context
+ *                      Context for the work
+ *  \param[out] a_item  The first stolen item
+ *  \return             T - items were stolen
+ *//*-----------------------------------------------------------------*/
+
+bool
+ThreadPool::steal(const int a_thread,
+                  Job&      a_job,
+                  void*&    a_context,
+                  int&      a_item)
+{
+  for (int offset = 1; offset != m_numThread; ++offset)
+    {
+      WorkDeque& victim = m_deque[(a_thread + offset) % m_numThread];
+      int stolenEnd;
+      {
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+        const int numItem = victim.m_end - victim.m_begin;
+        if (numItem == 0) continue;
+        a_job = victim.m_job;
+        a_context = victim.m_context;
+        stolenEnd = victim.m_end;
+        victim.m_end -= (numItem + 1)/2;
+        a_item = victim.m_end;
+      }
+      WorkDeque& deque = m_deque[a_thread];
+      std::lock_guard<std::mutex> lock(deque.m_mutex);
+      CH_assert(deque.m_begin == deque.m_end);
+      deque.m_job = a_job;
+      deque.m_context = a_context;
+      deque.m_begin = a_item + 1;
+      deque.m_end = stolenEnd;
+      return true;
+    }
+  return false;
+}
+
+/*--------------------------------------------------------------------*/
+//  Loop run by the threads of the pool (other than the calling
+//  thread)
+/** \param[in]  a_thread
+ *                      Index of the thread
+ *  \param[in]  a_pin   T - pin the thread to a CPU
+ *//*-----------------------------------------------------------------*/
+
+void
+ThreadPool::threadMain(const int a_thread, const bool a_pin)
+{
+  if (a_pin)
+    {
+      System::pinThread(a_thread);
+    }
+  s_threadIndex = a_thread;
+  unsigned generation = 0;
+  while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvStart.wait(lock,
+                       [this, generation]
+                       {
+                         return m_stop || m_generation != generation;
+                       });
+        if (m_stop) return;
+        generation = m_generation;
+      }
+      work(a_thread);
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_numBusy == 0)
+        {
+          m_cvDone.notify_one();
+        }
+    }
+}
@@ -1,10 +1,123 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <cstdint>
 
 #include "BaseFab.H"
+#include "BaseFabMacros.H"
 #include "BoxIterator.H"
 
+/*--------------------------------------------------------------------*/
+//  Test indexing, copying, and linearization of a layout against the
+//  default (component-major) layout.  Returns the number of failures.
+/*--------------------------------------------------------------------*/
+
+template <typename Layout>
+int testLayout(const FabPadding& a_padding)
+{
+  int statusLO = 0;
+  const int ncomp = 3;
+  Box boxL(IntVect(D_DECL(-1, -1, -1)), IntVect(D_DECL(9, 4, 2)));
+  BaseFab<Real, Layout> fabL(boxL, ncomp, a_padding);
+  FArrayBox fabS(boxL, ncomp);
+  fabL.setVal(-1.);
+  // MD_ARRAY agrees with operator()
+  {
+    MD_ARRAY(arrL, fabL);
+    MD_BOXLOOP(boxL, i)
+      {
+        const IntVect iv(D_DECL(i0, i1, i2));
+        for (int c = 0; c != ncomp; ++c)
+          {
+            if (&arrL[MD_IX(i, c)] != &fabL(iv, c)) ++statusLO;
+            arrL[MD_IX(i, c)] = D_TERM(1000*i0, + 100*i1, + 10*i2) + c;
+            fabS(iv, c) = arrL[MD_IX(i, c)];
+          }
+      }
+  }
+  // Elements are distinct and within the allocation
+  {
+    std::vector<int> count(fabL.size(), 0);
+    for (BoxIterator bit(boxL); bit.ok(); ++bit)
+      {
+        for (int c = 0; c != ncomp; ++c)
+          {
+            const std::ptrdiff_t off = &fabL(*bit, c) - fabL.dataPtr();
+            if (off < 0 || off >= (std::ptrdiff_t)fabL.size()) ++statusLO;
+            else if (++count[off] != 1) ++statusLO;
+          }
+      }
+  }
+  // Interleaving of components
+  if (Layout::s_cellMajor)
+    {
+      if (&fabL(boxL.loVect(), 1) - &fabL(boxL.loVect(), 0) !=
+          Layout::s_width) ++statusLO;
+    }
+  // The anchor cell is aligned
+  if (a_padding.align > 0)
+    {
+      IntVect iv = boxL.loVect();
+      iv[0] += a_padding.anchor;
+      if (reinterpret_cast<std::uintptr_t>(&fabL(iv, 0)) %
+          a_padding.align != 0) ++statusLO;
+    }
+  // Linear buffers are component-major for every layout
+  {
+    Box region(IntVect::Zero, IntVect(D_DECL(6, 3, 1)));
+    std::vector<Real> bufL(2*region.size());
+    std::vector<Real> bufS(2*region.size());
+    fabL.linearOut(bufL.data(), region, 1, 3);
+    fabS.linearOut(bufS.data(), region, 1, 3);
+    if (bufL != bufS) ++statusLO;
+    BaseFab<Real, Layout> fabM(region, ncomp, -2.);
+    fabM.linearIn(bufS.data(), region, 1, 3);
+    for (BoxIterator bit(region); bit.ok(); ++bit)
+      {
+        if (fabM(*bit, 0) != -2.) ++statusLO;
+        if (fabM(*bit, 1) != fabS(*bit, 1)) ++statusLO;
+        if (fabM(*bit, 2) != fabS(*bit, 2)) ++statusLO;
+      }
+  }
+  // Copy with shifted regions and components
+  {
+    Box dstBox(IntVect::Zero, IntVect(D_DECL(4, 2, 1)));
+    Box srcBox(dstBox);
+    srcBox.shift(IntVect::Unit);
+    BaseFab<Real, Layout> fabN(dstBox, ncomp, -3.);
+    fabN.copy(dstBox, 0, fabL, srcBox, 1, 2);
+    for (BoxIterator bit(dstBox); bit.ok(); ++bit)
+      {
+        const IntVect ivSrc = *bit + IntVect::Unit;
+        if (fabN(*bit, 0) != fabS(ivSrc, 1)) ++statusLO;
+        if (fabN(*bit, 1) != fabS(ivSrc, 2)) ++statusLO;
+        if (fabN(*bit, 2) != -3.) ++statusLO;
+      }
+    // Whole fab and all components
+    BaseFab<Real, Layout> fabW(boxL, ncomp, a_padding);
+    fabW.copy(boxL, fabL);
+    BaseFab<Real, Layout> fabX(Box(IntVect::Zero, IntVect(D_DECL(5, 2, 1))), ncomp, -3.);
+    fabX.copy(fabX.box(), fabL);
+    for (BoxIterator bit(boxL); bit.ok(); ++bit)
+      {
+        for (int c = 0; c != ncomp; ++c)
+          {
+            if (fabW(*bit, c) != fabS(*bit, c)) ++statusLO;
+            if (fabX.box().contains(*bit) &&
+                fabX(*bit, c) != fabS(*bit, c)) ++statusLO;
+          }
+      }
+    // Setting one component leaves the others
+    fabN.setVal(1, 4.);
+    for (BoxIterator bit(dstBox); bit.ok(); ++bit)
+      {
+        if (fabN(*bit, 1) != 4.) ++statusLO;
+        if (fabN(*bit, 2) != -3.) ++statusLO;
+      }
+  }
+  return statusLO;
+}
+
 int main(const int argc, const char* argv[])
 { 
   const bool verbose = ((argc == 2) && (std::strcmp(argv[1], "-v") == 0));
@@ -209,6 +322,53 @@ int main(const int argc, const char* argv[])
   }
 #endif
 
+  // Test copy fast paths
+  {
+    int statusFP = 0;
+    Box boxE(IntVect(D_DECL(-2, -2, -2)), IntVect(D_DECL(5, 4, 3)));
+    FArrayBox fabE(boxE, 4, FabPadding::cacheLine(2));
+    for (BoxIterator bit(boxE); bit.ok(); ++bit)
+      {
+        for (int c = 0; c != 4; ++c)
+          {
+            fabE(*bit, c) = D_TERM(1000*(*bit)[0], + 100*(*bit)[1],
+                                   + 10*(*bit)[2]) + c;
+          }
+      }
+    // Same storage is copied as a block
+    FArrayBox fabF(boxE, 4, FabPadding::cacheLine(2));
+    fabF.copy(boxE, fabE);
+    // Skip component 1
+    const CompSet compSet = CompSet::all().erase(1);
+    Box boxG(boxE);
+    boxG.grow(-1);
+    FArrayBox fabG(boxG, 4, -1.);
+    fabG.copy(boxG, 0, fabE, boxG, 0, 4, compSet);
+    std::vector<Real> buffer(3*boxG.size());
+    fabE.linearOut(buffer.data(), boxG, 0, 4, compSet);
+    FArrayBox fabH(boxG, 4, -1.);
+    fabH.linearIn(buffer.data(), boxG, 0, 4, compSet);
+    for (BoxIterator bit(boxE); bit.ok(); ++bit)
+      {
+        for (int c = 0; c != 4; ++c)
+          {
+            if (fabF(*bit, c) != fabE(*bit, c)) ++statusFP;
+            if (boxG.contains(*bit))
+              {
+                const Real expect = (c == 1) ? -1. : fabE(*bit, c);
+                if (fabG(*bit, c) != expect) ++statusFP;
+                if (fabH(*bit, c) != expect) ++statusFP;
+              }
+          }
+      }
+    if (verbose || statusFP != 0)
+      {
+        std::cout << "Copy fast path test " << statLbl[(statusFP == 0)]
+                  << std::endl;
+      }
+    status += statusFP;
+  }
+
   // Test linearout and linear in
 #if 1
   {
@@ -256,6 +416,90 @@ int main(const int argc, const char* argv[])
   }
 #endif
 
+  // Test padded storage
+  {
+    int statusPad = 0;
+    // Ghosted box with 1 ghost cell and an odd length in i0
+    Box boxP(IntVect(D_DECL(-1, -1, -1)), IntVect(D_DECL(9, 4, 2)));
+    FArrayBox fabP(boxP, 2, FabPadding::cacheLine(1));
+    const int alignElem = FabPadding::s_cacheLine/sizeof(Real);
+    if (g_SpaceDim > 1 && fabP.getStride()[1] % alignElem != 0) ++statusPad;
+    if (fabP.getComponentStride() % alignElem != 0) ++statusPad;
+    if (fabP.size() < boxP.size()*fabP.ncomp()) ++statusPad;
+    // First interior cell of every row is aligned
+    {
+      Box interior(boxP);
+      interior.grow(-1);
+      interior.hiVect(0) = interior.loVect(0);
+      for (BoxIterator bit(interior); bit.ok(); ++bit)
+        {
+          for (int c = 0; c != 2; ++c)
+            {
+              if (reinterpret_cast<std::uintptr_t>(&fabP(*bit, c)) %
+                  FabPadding::s_cacheLine != 0) ++statusPad;
+            }
+        }
+    }
+    // MD_ARRAY agrees with operator()
+    {
+      MD_ARRAY(arrP, fabP);
+      MD_BOXLOOP(boxP, i)
+        {
+          const IntVect iv(D_DECL(i0, i1, i2));
+          if (&arrP[MD_IX(i, 1)] != &fabP(iv, 1)) ++statusPad;
+          arrP[MD_IX(i, 0)] = D_TERM(100*i0, + 10*i1, + i2);
+          arrP[MD_IX(i, 1)] = -arrP[MD_IX(i, 0)];
+        }
+    }
+    // Linear out of a padded fab and in to a packed fab
+    {
+      Box region(IntVect::Zero, IntVect(D_DECL(8, 3, 1)));
+      std::vector<Real> buffer(2*region.size());
+      fabP.linearOut(buffer.data(), region, 0, 2);
+      FArrayBox fabQ(region, 2);
+      fabQ.linearIn(buffer.data(), region, 0, 2);
+      for (BoxIterator bit(region); bit.ok(); ++bit)
+        {
+          if (fabQ(*bit, 0) != fabP(*bit, 0)) ++statusPad;
+          if (fabQ(*bit, 1) != fabP(*bit, 1)) ++statusPad;
+        }
+    }
+    // Power of 2 boxes are padded to avoid cache-set aliasing
+    {
+      Box box64(IntVect::Zero, IntVect(D_DECL(63, 63, 63)));
+      FArrayBox fab64(box64, 2, FabPadding::cacheLine());
+      for (int dir = 1; dir != g_SpaceDim; ++dir)
+        {
+          if ((fab64.getStride()[dir]*sizeof(Real)) %
+              FabPadding::s_aliasBytes == 0) ++statusPad;
+        }
+      if ((fab64.getComponentStride()*sizeof(Real)) %
+          FabPadding::s_aliasBytes == 0) ++statusPad;
+    }
+    if (verbose || statusPad != 0)
+      {
+        std::cout << "Padding test " << statLbl[(statusPad == 0)]
+                  << std::endl;
+      }
+    status += statusPad;
+  }
+
+  // Test layouts
+  {
+    int statusLO = 0;
+    statusLO += testLayout<FabLayout::CellMajor>(FabPadding::packed());
+    statusLO += testLayout<FabLayout::CellMajor>(FabPadding::cacheLine(1));
+    statusLO += testLayout<FabLayout::AoSoA<4> >(FabPadding::packed());
+    statusLO += testLayout<FabLayout::AoSoA<4> >(FabPadding::cacheLine(1));
+    statusLO += testLayout<FabLayout::AoSoA<8> >(FabPadding::cacheLine(3));
+    if (verbose || statusLO != 0)
+      {
+        std::cout << "Layout test " << statLbl[(statusLO == 0)]
+                  << std::endl;
+      }
+    status += statusLO;
+  }
+
 //--Output status
 
   if (verbose)
@@ -1,8 +1,11 @@
 #include <iostream>
 #include <iomanip>
 #include <cstring>
+#include <algorithm>
 
 #include "DisjointBoxLayout.H"
+#include "LayoutIterator.H"
+#include "BoxIterator.H"
 
 int main(const int argc, const char* argv[])
 {
@@ -83,6 +86,229 @@ int main(const int argc, const char* argv[])
 #endif
 
 
+//--Boxes that do not fit evenly
+
+  {
+    // 10 cells with max size 4 gives boxes of size 4, 3, 3
+    DisjointBoxLayout dbl2(domain, 4*IntVect::Unit, BoxOrder::lexicographic,
+                           LoadBalance::roundRobin);
+    if (dbl2.dimensions() != 3*IntVect::Unit) ++status;
+    if (dbl2.size() != (3*IntVect::Unit).product()) ++status;
+    const Box& firstBox = dbl2[BoxIndex(dbl2.linearIndex(0), 0)];
+    if (firstBox != Box(IntVect::Zero, 3*IntVect::Unit)) ++status;
+    const Box& lastBox = dbl2[BoxIndex(dbl2.linearIndex(dbl2.size()-1), 0)];
+    if (lastBox != Box(7*IntVect::Unit, 9*IntVect::Unit)) ++status;
+    // Boxes cover the domain
+    int numCell = 0;
+    for (LayoutIterator lit(dbl2); lit.ok(); ++lit)
+      {
+        if (!domain.contains(dbl2[lit])) ++status;
+        numCell += dbl2[lit].size();
+      }
+    if (numCell != domain.size()) ++status;
+    // Grid and linear indices are consistent
+    for (int linIdxBox = 0; linIdxBox != dbl2.size(); ++linIdxBox)
+      {
+        const int gridIdx = dbl2.getLinear(linIdxBox).gridIdx;
+        if (dbl2.linearIndex(gridIdx) != linIdxBox) ++status;
+        if (dbl2.linearNbrOffset(dbl2.gridIV(linIdxBox)) != gridIdx) ++status;
+      }
+    // Neighbours are adjacent
+    for (LayoutIterator lit(dbl2); lit.ok(); ++lit)
+      {
+        int numNbr = 0;
+        for (NeighborIterator nbrit(lit); nbrit.ok(); ++nbrit)
+          {
+            Box grownBox(dbl2[lit]);
+            grownBox.grow(1);
+            grownBox &= dbl2[nbrit];
+            if (grownBox.isEmpty()) ++status;
+            if (dbl2.gridIV((*nbrit).globalIndex()) !=
+                dbl2.gridIV((*lit).globalIndex()) + nbrit.nbrDir()) ++status;
+            ++numNbr;
+          }
+        if (numNbr < (1 << g_SpaceDim) - 1) ++status;
+      }
+    if (DisjointBoxLayout::numProc() == 1)
+      {
+        if (dbl2.localSize() != dbl2.size()) ++status;
+      }
+  }
+
+//--Balancers (independent of the actual number of processes)
+
+  {
+    const int numBox = 27;
+    const int numProc = 6;
+    std::vector<Real> cost(numBox, 1.);
+    // Contiguous gives non-decreasing processes with 4 or 5 boxes each
+    {
+      const std::vector<int> proc = LoadBalance::contiguous(cost, numProc);
+      for (int i = 1; i != numBox; ++i)
+        {
+          if (proc[i] < proc[i-1] || proc[i] > proc[i-1] + 1) ++status;
+        }
+      for (const Real load : LoadBalance::procCost(cost, proc, numProc))
+        {
+          if (load < 4. || load > 5.) ++status;
+        }
+    }
+    // Round-robin
+    {
+      const std::vector<int> proc = LoadBalance::roundRobin(cost, numProc);
+      for (int i = 0; i != numBox; ++i)
+        {
+          if (proc[i] != i % numProc) ++status;
+        }
+    }
+    // Cost greedy with uneven costs is within the maximum cost of perfect
+    for (int i = 0; i != numBox; ++i)
+      {
+        cost[i] = 1 + (i*7) % 5;
+      }
+    {
+      const std::vector<int> proc = LoadBalance::costGreedy(cost, numProc);
+      const std::vector<Real> load =
+        LoadBalance::procCost(cost, proc, numProc);
+      const Real maxLoad = *std::max_element(load.begin(), load.end());
+      const Real minLoad = *std::min_element(load.begin(), load.end());
+      if (maxLoad - minLoad > 5.) ++status;
+      if (verbose)
+        {
+          std::cout << "Cost greedy loads:";
+          for (const Real x : load) std::cout << ' ' << x;
+          std::cout << std::endl;
+        }
+    }
+  }
+
+//--Box orders, assuming 8 processes
+
+  {
+    const Box domain3(IntVect::Zero, 15*IntVect::Unit);
+    const int numProc = 8;
+    const BoxOrder order[] = {
+      BoxOrder::lexicographic,
+      BoxOrder::morton,
+      BoxOrder::hilbert
+    };
+    long long numCell[3];
+    for (int iOrder = 0; iOrder != 3; ++iOrder)
+      {
+        DisjointBoxLayout dbl3;
+        dbl3.defineForProcs(numProc, 1, domain3, 2*IntVect::Unit,
+                            order[iOrder], LoadBalance::contiguous,
+                            std::vector<Real>{});
+        if (dbl3.localIdxBegin() != dbl3.size()/numProc) ++status;
+        if (dbl3.localSize() != dbl3.size()/numProc) ++status;
+        for (int linIdxBox = 0; linIdxBox != dbl3.size(); ++linIdxBox)
+          {
+            if (dbl3.getLinear(linIdxBox).proc !=
+                linIdxBox/(dbl3.size()/numProc)) ++status;
+            // Consecutive boxes on a Hilbert curve are face neighbours
+            if (order[iOrder] == BoxOrder::hilbert && linIdxBox > 0)
+              {
+                IntVect step = dbl3.gridIV(linIdxBox) -
+                  dbl3.gridIV(linIdxBox - 1);
+                step.max(-step);
+                if (step.sum() != 1) ++status;
+              }
+            // The neighbour table wraps periodically
+            const IntVect iv = dbl3.gridIV(linIdxBox);
+            for (BoxIterator nbrit(Box(-2*IntVect::Unit, 2*IntVect::Unit));
+                 nbrit.ok(); ++nbrit)
+              {
+                IntVect nbrIV = iv + *nbrit;
+                for (int dir = 0; dir != g_SpaceDim; ++dir)
+                  {
+                    nbrIV[dir] = (nbrIV[dir] + 8) % 8;
+                  }
+                if (dbl3.gridIV(dbl3.nbrIndex(linIdxBox, *nbrit)) != nbrIV)
+                  {
+                    ++status;
+                  }
+              }
+          }
+        // Each process holds a cube of boxes with Morton ordering
+        if (order[iOrder] == BoxOrder::morton)
+          {
+            IntVect lo(dbl3.getLinear(0).box.loVect());
+            IntVect hi(dbl3.getLinear(0).box.hiVect());
+            for (int linIdxBox = 1; linIdxBox != dbl3.size()/numProc;
+                 ++linIdxBox)
+              {
+                lo.min(dbl3.getLinear(linIdxBox).box.loVect());
+                hi.max(dbl3.getLinear(linIdxBox).box.hiVect());
+              }
+            if (lo != IntVect::Zero || hi != 7*IntVect::Unit) ++status;
+          }
+        const std::vector<DisjointBoxLayout::CommVolume> volume =
+          dbl3.commVolume(1, PeriodicX | PeriodicY | PeriodicZ);
+        if ((int)volume.size() != numProc) ++status;
+        numCell[iOrder] = 0;
+        long long numGhostCell = 0;
+        for (const DisjointBoxLayout::CommVolume& vol : volume)
+          {
+            numCell[iOrder] += vol.numCell;
+            numGhostCell += vol.numCell + vol.numLocalCell;
+          }
+        // All ghost cells are filled
+        Box grownBox(IntVect::Zero, IntVect::Unit);
+        grownBox.grow(1);
+        if (numGhostCell != (long long)dbl3.size()*
+            (grownBox.size() - (2*IntVect::Unit).product())) ++status;
+        if (verbose)
+          {
+            std::cout << "Order " << iOrder << " remote ghost cells: "
+                      << numCell[iOrder] << std::endl;
+          }
+      }
+    // Curves have less surface between processes than slabs
+    if (numCell[1] >= numCell[0]) ++status;
+    if (numCell[2] >= numCell[0]) ++status;
+  }
+
+//--Interior and boundary boxes
+
+  {
+    // Boxes of size 4, 3, 3 in each direction
+    DisjointBoxLayout dbl4(domain, 4*IntVect::Unit);
+    for (int radius = 0; radius != 3; ++radius)
+      {
+        for (LayoutIterator lit(dbl4); lit.ok(); ++lit)
+          {
+            const Box& box = dbl4[lit];
+            const Box interior = dbl4.interiorBox(*lit, radius);
+            const std::vector<Box> slabs = dbl4.boundaryBoxes(*lit, radius);
+            if (radius == 0 && (interior != box || !slabs.empty())) ++status;
+            if ((int)slabs.size() > 2*g_SpaceDim) ++status;
+            // Interior and slabs are disjoint and cover the box
+            int numCell = (interior.isEmpty()) ? 0 : interior.size();
+            for (int i = 0, i_end = slabs.size(); i != i_end; ++i)
+              {
+                if (slabs[i].isEmpty() || !box.contains(slabs[i])) ++status;
+                numCell += slabs[i].size();
+                Box overlap(slabs[i]);
+                if (!interior.isEmpty() && !(overlap &= interior).isEmpty())
+                  ++status;
+                for (int j = 0; j != i; ++j)
+                  {
+                    overlap = slabs[i];
+                    if (!(overlap &= slabs[j]).isEmpty()) ++status;
+                  }
+              }
+            if (numCell != box.size()) ++status;
+            // The stencil of interior cells stays in the box
+            if (!interior.isEmpty())
+              {
+                Box grown(interior);
+                grown.grow(radius);
+                if (!box.contains(grown)) ++status;
+              }
+          }
+      }
+  }
+
 //--Output status
   if (verbose)
     {
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstring>
+
+#include "FabAllocator.H"
+#include "BaseFab.H"
+
+int main(const int argc, const char* argv[])
+{
+  const bool verbose = ((argc == 2) && (std::strcmp(argv[1], "-v") == 0));
+  const char* const statLbl[] = {
+    "failed",
+    "passed"
+  };
+  int status = 0;
+
+  auto isAligned = [](const void *const a_addr, const size_t a_align)
+    {
+      return (reinterpret_cast<std::uintptr_t>(a_addr) % a_align) == 0;
+    };
+
+//--Tests
+
+  // Size classes
+  {
+    int statusSC = 0;
+    if (PoolAllocator::sizeClass(1) != 64) ++statusSC;
+    if (PoolAllocator::sizeClass(64) != 64) ++statusSC;
+    if (PoolAllocator::sizeClass(65) != 128) ++statusSC;
+    if (PoolAllocator::sizeClass(4096) != 4096) ++statusSC;
+    if (PoolAllocator::sizeClass(4097) != 5120) ++statusSC;
+    if (PoolAllocator::sizeClass(8192) != 8192) ++statusSC;
+    if (PoolAllocator::sizeClass(8193) != 10240) ++statusSC;
+    // At most 25% waste
+    for (size_t n = 4097; n < (size_t)1 << 20; n += 997)
+      {
+        const size_t c = PoolAllocator::sizeClass(n);
+        if (c < n || 4*(c - n) > n) ++statusSC;
+      }
+    if (verbose || statusSC != 0)
+      {
+        std::cout << "Size class test " << statLbl[(statusSC == 0)]
+                  << std::endl;
+      }
+    status += statusSC;
+  }
+
+  // Alignment and recycling of the pool
+  {
+    int statusPool = 0;
+    PoolAllocator pool;
+    void* small = pool.allocate(100);
+    void* large = pool.allocate(100000);
+    if (!isAligned(small, FabAllocator::s_lineAlign)) ++statusPool;
+    if (!isAligned(large, FabAllocator::s_pageAlign)) ++statusPool;
+    if (pool.numMisses() != 2) ++statusPool;
+    pool.deallocate(large, 100000);
+    if (pool.cachedBytes() != PoolAllocator::sizeClass(100000)) ++statusPool;
+    // Same size class is recycled
+    void* large2 = pool.allocate(99000);
+    if (large2 != large) ++statusPool;
+    if (pool.numHits() != 1) ++statusPool;
+    if (pool.cachedBytes() != 0) ++statusPool;
+    pool.deallocate(large2, 99000);
+    pool.deallocate(small, 100);
+    pool.release();
+    if (pool.cachedBytes() != 0) ++statusPool;
+    // Blocks beyond the cache limit are returned to the system
+    pool.setMaxCachedBytes(4096);
+    void* block = pool.allocate(8192);
+    pool.deallocate(block, 8192);
+    if (pool.cachedBytes() != 0) ++statusPool;
+    if (verbose || statusPool != 0)
+      {
+        std::cout << "Pool test " << statLbl[(statusPool == 0)]
+                  << std::endl;
+      }
+    status += statusPool;
+  }
+
+  // BaseFabs use the current allocator
+  {
+    int statusFab = 0;
+    PoolAllocator pool;
+    FabAllocator::setCurrent(&pool);
+    Box box(IntVect::Zero, IntVect(D_DECL(15, 15, 15)));
+    const Real* addr;
+    {
+      FArrayBox fabA(box, 2, 1.);
+      addr = fabA.dataPtr();
+      if (!isAligned(addr, FabAllocator::s_pageAlign)) ++statusFab;
+      FArrayBox fabB(box, 1);
+      if (!isAligned(fabB.dataPtr(), FabAllocator::s_pageAlign)) ++statusFab;
+      // Moved fabs return memory to the allocator exactly once
+      FArrayBox fabC;
+      fabC = std::move(fabB);
+      FArrayBox fabD(std::move(fabC));
+    }
+    if (pool.numMisses() != 2) ++statusFab;
+    // Redefining with the same size reuses memory
+    FArrayBox fabE;
+    fabE.define(box, 2);
+    if (fabE.dataPtr() != addr) ++statusFab;
+    if (pool.numHits() != 1) ++statusFab;
+    // Switching the allocator does not affect existing fabs
+    FabAllocator::setCurrent(nullptr);
+    fabE.define(box, 1);
+    if (pool.cachedBytes() !=
+        PoolAllocator::sizeClass(2*box.size()*sizeof(Real)) +
+        PoolAllocator::sizeClass(box.size()*sizeof(Real))) ++statusFab;
+    // Small fabs are aligned to a cache line
+    BaseFab<char> fabF(Box(IntVect::Zero, IntVect::Unit), 1);
+    if (!isAligned(fabF.dataPtr(), FabAllocator::s_lineAlign)) ++statusFab;
+    if (verbose || statusFab != 0)
+      {
+        std::cout << "BaseFab allocation test " << statLbl[(statusFab == 0)]
+                  << std::endl;
+      }
+    status += statusFab;
+  }
+
+//--Output status
+
+  if (verbose)
+    {
+      std::cout << "Status: " << status << std::endl;
+    }
+  const char* const testName = "testFabAllocator";
+  std::cout << std::left << std::setw(40) << testName
+            << statLbl[(status == 0)] << std::endl;
+  return status;
+}
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <iomanip>
+#include <vector>
 
 #include "LayoutIterator.H"
 
@@ -189,6 +190,54 @@ int main(const int argc, const char* argv[])
   }
 #endif
 
+  // Tiles, grown on the sides shared with their box and visited by
+  // several threads, cover each grown box exactly once
+  {
+    const IntVect tileSize(D_DECL(3, 2, 4));
+    std::vector<std::vector<int> > count(dbl.size());
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        Box grownBox(dbl[dit]);
+        grownBox.grow(1);
+        count[(*dit).globalIndex()].assign(grownBox.size(), 0);
+      }
+    int numErr = 0;
+#pragma omp parallel num_threads(3) reduction(+:numErr)
+    for (TileIterator tit(dbl, tileSize); tit.ok(); ++tit)
+      {
+        if (tit.numTile() != D_TERM(2, *2, *1)) ++numErr;
+        Box grownBox(tit.validBox());
+        grownBox.grow(1);
+        const Box tile = tit.tileBox(1);
+        if (!grownBox.contains(tile)) ++numErr;
+        const IntVect dims = grownBox.dimensions();
+        std::vector<int>& countBox = count[(*tit).globalIndex()];
+        for (BoxIterator bit(tile); bit.ok(); ++bit)
+          {
+            const IntVect iv = *bit - grownBox.loVect();
+            int idx = iv[g_SpaceDim - 1];
+            for (int dir = g_SpaceDim - 2; dir >= 0; --dir)
+              {
+                idx = idx*dims[dir] + iv[dir];
+              }
+#pragma omp atomic
+            ++countBox[idx];
+          }
+      }
+    status += numErr;
+    for (const std::vector<int>& countBox : count)
+      {
+        for (const int c : countBox)
+          {
+            if (c != 1) ++status;
+          }
+      }
+    if (verbose && status)
+      {
+        std::cout << "Tiles: status " << status << std::endl;
+      }
+  }
+
 //--Output status
 
   if (verbose)
@@ -171,6 +171,309 @@ int main(const int argc, const char* argv[])
   }
 #endif
 
+  // Test the copier cache
+  {
+    const int cacheSize0 = Copier::cacheSize();
+    Copier& cached = Copier::cachedExchangeLD(lvldata);
+    if (Copier::cacheSize() != cacheSize0 + 1) ++status;
+    // Same arguments give the same copier
+    if (&Copier::cachedExchangeLD(lvldata) != &cached) ++status;
+    if (cached.numMotionItem() != copier.numMotionItem()) ++status;
+    // Different arguments give a different copier
+    Copier& cachedPeriodic =
+      Copier::cachedExchangeLD(lvldata, PeriodicX | PeriodicY | PeriodicZ);
+    if (&cachedPeriodic == &cached) ++status;
+    if (cachedPeriodic.numMotionItem() <= cached.numMotionItem()) ++status;
+    if (&Copier::cachedExchangeDBL<Real>(dbl, 1, 0, 1) == &cached) ++status;
+    if (Copier::cacheSize() != cacheSize0 + 3) ++status;
+    // Exchange with the cached copier
+    c = 1;
+    for (DataIterator dit(dbl); dit.ok(); ++dit, ++c)
+      {
+        lvldata[dit].setVal(0, (Real)c);
+        lvldata[dit].setVal(1, (Real)(-c));
+      }
+    LevelData<BaseFab<Real> > lvldataRef(dbl, 2, 1);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        lvldataRef[dit].copy(lvldata[dit].box(), lvldata[dit]);
+      }
+    lvldataRef.exchange(copier);
+    lvldata.exchange();
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        for (BoxIterator bit(lvldata[dit].box()); bit.ok(); ++bit)
+          {
+            if (lvldata[dit](*bit, 0) != lvldataRef[dit](*bit, 0) ||
+                lvldata[dit](*bit, 1) != lvldataRef[dit](*bit, 1)) ++status;
+          }
+      }
+    // Copiers for a destroyed layout are removed when a new one is defined
+    {
+      DisjointBoxLayout dblTmp(domain, 2*IntVect::Unit);
+      LevelData<BaseFab<Real> > lvldataTmp(dblTmp, 1, 1);
+      lvldataTmp.exchange();
+      if (Copier::cacheSize() != cacheSize0 + 4) ++status;
+    }
+    {
+      DisjointBoxLayout dblTmp(domain, 8*IntVect::Unit);
+      LevelData<BaseFab<Real> > lvldataTmp(dblTmp, 1, 1);
+      Copier& cachedTmp = Copier::cachedExchangeLD(lvldataTmp);
+      if (Copier::cacheSize() != cacheSize0 + 4) ++status;
+      if (cachedTmp.numMotionItem() != 0) ++status;
+    }
+    Copier::clearCache();
+    if (Copier::cacheSize() != 0) ++status;
+  }
+
+  // Test threading over motion items
+  {
+    Copier copierPerCopy;
+    copierPerCopy.setThreading(CopierThreading::perCopy);
+    copierPerCopy.defineExchangeLD(lvldata, PeriodicX | PeriodicY | PeriodicZ);
+    Copier copierItems;
+    if (copierItems.threading() != CopierThreading::motionItems) ++status;
+    copierItems.defineExchangeLD(lvldata, PeriodicX | PeriodicY | PeriodicZ);
+    // Local items are grouped by destination box
+    int numLocalItem = 0;
+    for (int g = 0, g_end = copierItems.numLocalGroup(); g != g_end; ++g)
+      {
+        const int nGroupItem = copierItems.numLocalGroupItem(g);
+        if (nGroupItem <= 0) ++status;
+        const int idxRecv =
+          copierItems[copierItems.localItemIndex(g, 0)].bidxRecv().localIndex();
+        for (int i = 0; i != nGroupItem; ++i)
+          {
+            const Motion2Way& motion =
+              copierItems[copierItems.localItemIndex(g, i)];
+            if (!motion.isLocal() ||
+                motion.bidxRecv().localIndex() != idxRecv) ++status;
+          }
+        numLocalItem += nGroupItem;
+      }
+    int numLocalItemRef = 0;
+    for (int midx = 0; midx != copierItems.numMotionItem(); ++midx)
+      {
+        if (copierItems[midx].isLocal()) ++numLocalItemRef;
+      }
+    if (numLocalItem != numLocalItemRef) ++status;
+    // Both give the same ghost cells
+    LevelData<BaseFab<Real> > lvldataRef(dbl, 2, 1);
+    c = 1;
+    for (DataIterator dit(dbl); dit.ok(); ++dit, ++c)
+      {
+        lvldata[dit].setVal(0, (Real)c);
+        lvldata[dit].setVal(1, (Real)(-c));
+        lvldataRef[dit].copy(lvldata[dit].box(), lvldata[dit]);
+      }
+    lvldataRef.exchange(copierPerCopy);
+    lvldata.exchange(copierItems);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        for (BoxIterator bit(lvldata[dit].box()); bit.ok(); ++bit)
+          {
+            if (lvldata[dit](*bit, 0) != lvldataRef[dit](*bit, 0) ||
+                lvldata[dit](*bit, 1) != lvldataRef[dit](*bit, 1)) ++status;
+          }
+      }
+  }
+
+  // Test a group of LevelData exchanged together
+  {
+    LevelData<BaseFab<Real> > lvldataB(dbl, 3, 1);
+    LevelData<BaseFab<Real> > lvldataRef(dbl, 2, 1);
+    LevelData<BaseFab<Real> > lvldataBRef(dbl, 3, 1);
+    c = 1;
+    for (DataIterator dit(dbl); dit.ok(); ++dit, ++c)
+      {
+        lvldata[dit].setVal(-1.);
+        lvldataB[dit].setVal(-1.);
+        for (int comp = 0; comp != 2; ++comp)
+          {
+            lvldata[dit].setVal(comp, (Real)(c + 10*comp));
+          }
+        for (int comp = 0; comp != 3; ++comp)
+          {
+            lvldataB[dit].setVal(comp, (Real)(-c - 10*comp));
+          }
+        lvldataRef[dit].copy(lvldata[dit].box(), lvldata[dit]);
+        lvldataBRef[dit].copy(lvldataB[dit].box(), lvldataB[dit]);
+      }
+    // Reference is separate exchanges (only component 2 of lvldataB)
+    const unsigned periodic = PeriodicX | PeriodicY | PeriodicZ;
+    lvldataRef.exchange(periodic);
+    Copier copierB;
+    copierB.defineExchangeDBL<Real>(dbl, 1, 2, 1, periodic);
+    lvldataBRef.exchange(copierB);
+    LevelDataGroup<BaseFab<Real> > group;
+    group.add(lvldata);
+    group.add(lvldataB, 2, 1);
+    group.exchange(periodic);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        for (BoxIterator bit(lvldata[dit].box()); bit.ok(); ++bit)
+          {
+            for (int comp = 0; comp != 2; ++comp)
+              {
+                if (lvldata[dit](*bit, comp) != lvldataRef[dit](*bit, comp))
+                  ++status;
+              }
+            for (int comp = 0; comp != 3; ++comp)
+              {
+                if (lvldataB[dit](*bit, comp) != lvldataBRef[dit](*bit, comp))
+                  ++status;
+              }
+          }
+      }
+    Copier::clearCache();
+  }
+
+  // Test message sizes of a motion item moving 2 of 40 components
+  // (component 39 is beyond the reach of a 32-bit mask)
+  {
+    const BoxIndex bidxA = dbl.dataIndex(0);
+    const BoxIndex bidxB = dbl.dataIndex(1);
+    const IntVect sendDir = IntVect(D_DECL(1, 0, 0));
+    Box regionSend(dbl[bidxA]);
+    regionSend.loVect(0) = regionSend.hiVect(0);
+    Box regionRecv(regionSend);
+    regionRecv.shift(1, 0);
+    Motion2Way motion(40*sizeof(Real), dbl, bidxA, bidxB,
+                      regionRecv, regionSend, regionRecv, sendDir, false);
+    if (motion.numBytesRecv() != 40*sizeof(Real)*regionRecv.size())
+      ++status;
+    motion.setCompSets(CompSet({ 0, 39 }), CompSet({ 39 }), sizeof(Real),
+                       0, 40);
+    if (motion.numBytesRecv() != 2*sizeof(Real)*regionRecv.size()) ++status;
+    if (motion.numBytesSend() != sizeof(Real)*regionSend.size()) ++status;
+    if (!motion.compRecv().contains(39) || motion.compSend().contains(0))
+      ++status;
+  }
+
+  // Test exchange of the components selected for each direction.  Corners
+  // move no components.  Component 39 is only moved in direction +x.
+  {
+    const int numComp = 40;
+    LevelData<BaseFab<Real> > lvldataS(dbl, numComp, 1);
+    auto dirCompSet = [](const IntVect& a_dir) -> CompSet
+      {
+        if (D_TERM(a_dir[0] != 0, && a_dir[1] != 0, && a_dir[2] != 0))
+          {
+            return CompSet::none();
+          }
+        CompSet compSet({ D_TERM((a_dir[0] + 1),
+                                 + 3*(a_dir[1] + 1),
+                                 + 9*(a_dir[2] + 1)) });
+        if (a_dir[0] > 0) compSet.insert(39);
+        return compSet;
+      };
+    auto cellVal = [](IntVect a_iv, const int a_comp) -> Real
+      {
+        for (int dir = 0; dir != g_SpaceDim; ++dir)
+          {
+            a_iv[dir] = (a_iv[dir] + 8) % 8;
+          }
+        return 100*D_TERM(a_iv[0], + 8*a_iv[1], + 64*a_iv[2]) + a_comp;
+      };
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        BaseFab<Real>& fab = lvldataS[dit];
+        fab.setVal(-1.);
+        for (BoxIterator bit(dbl[dit]); bit.ok(); ++bit)
+          {
+            for (int comp = 0; comp != numComp; ++comp)
+              {
+                fab(*bit, comp) = cellVal(*bit, comp);
+              }
+          }
+      }
+    Copier copierS;
+    copierS.setDirCompSet(dirCompSet);
+    copierS.defineExchangeLD(lvldataS, PeriodicX | PeriodicY | PeriodicZ);
+    if (copierS.numMotionItem() !=
+        numBox*(D_TERM(3, *3, *3) - 1 - D_TERM(2, *2, *2))) ++status;
+    lvldataS.exchange(copierS);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const Box& box = dbl[dit];
+        const BaseFab<Real>& fab = lvldataS[dit];
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            if (box.contains(*bit)) continue;
+            // Direction the ghost cell was received in
+            IntVect recvDir;
+            for (int dir = 0; dir != g_SpaceDim; ++dir)
+              {
+                recvDir[dir] = ((*bit)[dir] < box.loVect()[dir]) -
+                  ((*bit)[dir] > box.hiVect()[dir]);
+              }
+            const CompSet compSet = dirCompSet(recvDir);
+            for (int comp = 0; comp != numComp; ++comp)
+              {
+                const Real expect =
+                  (compSet.contains(comp)) ? cellVal(*bit, comp) : -1.;
+                if (fab(*bit, comp) != expect) ++status;
+              }
+          }
+      }
+    // The policy is kept when redefined, given directly to a define, and
+    // cleared with nullptr
+    const int numItemS = copierS.numMotionItem();
+    copierS.defineExchangeLD(lvldataS, PeriodicX | PeriodicY | PeriodicZ);
+    if (copierS.numMotionItem() != numItemS) ++status;
+    Copier copierT;
+    copierT.defineExchangeLD(lvldataS, PeriodicX | PeriodicY | PeriodicZ, 0u,
+                             dirCompSet);
+    if (copierT.numMotionItem() != numItemS) ++status;
+    copierS.setDirCompSet(nullptr);
+    copierS.defineExchangeLD(lvldataS, PeriodicX | PeriodicY | PeriodicZ);
+    if (copierS.numMotionItem() != numBox*(D_TERM(3, *3, *3) - 1)) ++status;
+  }
+
+  // Test memory accounting
+  {
+    using LDFab = LevelData<BaseFab<Real> >;
+    MemoryTracker::Category& fabMem = BaseFab<Real>::memoryCategory();
+    MemoryTracker::Category& ldMem = LDFab::memoryCategory();
+    const size_t fabBytes0 = fabMem.current();
+    const size_t ldBytes0 = ldMem.current();
+    const size_t totalBytes0 = MemoryTracker::total().current();
+    size_t numBytes = 0;
+    {
+      LDFab lvldataM(dbl, 3, 1);
+      numBytes = lvldataM.sizeBytes();
+      if (numBytes !=
+          (size_t)numBox*3*(6*IntVect::Unit).product()*sizeof(Real))
+        ++status;
+      if (fabMem.current() - fabBytes0 != numBytes) ++status;
+      if (ldMem.current() - ldBytes0 != numBytes) ++status;
+      if (MemoryTracker::total().current() - totalBytes0 != numBytes) ++status;
+      // Moving keeps the accounting
+      LDFab lvldataN(std::move(lvldataM));
+      BaseFab<Real> fab(Box(IntVect::Zero, IntVect::Unit), 1);
+      if (ldMem.current() - ldBytes0 != numBytes) ++status;
+      if (fabMem.current() - fabBytes0 != numBytes + fab.sizeBytes()) ++status;
+    }
+    // Padded BaseFabs allocate lead elements to align the anchor cell
+    {
+      LDFab lvldataP(dbl, 3, 1, FabPadding::cacheLine(1));
+      const size_t numBytesP = lvldataP.sizeBytes();
+      size_t numBytesData = 0;
+      for (DataIterator dit(dbl); dit.ok(); ++dit)
+        {
+          numBytesData += lvldataP[dit].size()*sizeof(Real);
+        }
+      if (numBytesP <= numBytesData) ++status;
+      if (fabMem.current() - fabBytes0 != numBytesP) ++status;
+      if (ldMem.current() - ldBytes0 != numBytesP) ++status;
+    }
+    if (fabMem.current() != fabBytes0) ++status;
+    if (ldMem.current() != ldBytes0) ++status;
+    if (MemoryTracker::total().current() != totalBytes0) ++status;
+    if (ldMem.peak() < ldBytes0 + numBytes) ++status;
+    if (verbose) MemoryTracker::report(std::cout);
+  }
+
 //--Output status
 
   if (verbose)
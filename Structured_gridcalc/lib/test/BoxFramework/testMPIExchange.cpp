@@ -1,6 +1,7 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
 
 #include "BaseFab.H"
 #include "DisjointBoxLayout.H"
@@ -87,71 +88,353 @@ int main(int argc, const char* argv[])
     }
 
 #if 1
-  // Exchange ghosts
+  // Exchange ghosts.  The persistent copier is used twice to check that
+  // restarting its requests sends the current data.  The last pass uses
+  // nonblocking messages.
   Copier copier;
   copier.defineExchangeLD(lvldata);
-  lvldata.exchange(copier);
-  // Check results
-  Box regionSend;
-  Box regionRecv;
-  c = 0;
-  for (DataIterator dit(dbl); dit.ok(); ++dit)
-    {
-      const Box box = dbl[dit];
-      // Process 0 works on box 0 (right or max side is of concern)
-      // Process 1 works on box 1 (left or min side is of concern)
-      const int side = 1 - 2*procID;
-      regionSend = box;
-      regionSend.adjBox(-1, 0, side);
-      regionRecv = box;
-      regionRecv.adjBox(1, 0, side);
-    }
-  if (verbose)
+  Copier copierNB(CopierProtocol::nonblocking);
+  copierNB.defineExchangeLD(lvldata);
+  for (int pass = 0; pass != 3; ++pass)
     {
+      for (DataIterator dit(dbl); dit.ok(); ++dit)
+        {
+          lvldata[dit].setVal(procID + 0.5 + pass);
+        }
+      lvldata.exchange((pass < 2) ? copier : copierNB);
+      // Check results
+      Box regionSend;
+      Box regionRecv;
+      c = 0;
+      for (DataIterator dit(dbl); dit.ok(); ++dit)
+        {
+          const Box box = dbl[dit];
+          // Process 0 works on box 0 (right or max side is of concern)
+          // Process 1 works on box 1 (left or min side is of concern)
+          const int side = 1 - 2*procID;
+          regionSend = box;
+          regionSend.adjBox(-1, 0, side);
+          regionRecv = box;
+          regionRecv.adjBox(1, 0, side);
+        }
+      if (verbose)
+        {
+          for (int iProc = 0; iProc != numProc; ++iProc)
+            {
+              if (iProc == procID)
+                {
+                  ost << "Proc " << procID
+                      << "\n  RegionSend" << regionSend
+                      << "\n  RegionRecv" << regionRecv << std::endl;
+                  std::cout << ost.str();
+                  ost.str("");
+                }
+              MPI_Barrier(MPI_COMM_WORLD);
+            }
+        }
       for (int iProc = 0; iProc != numProc; ++iProc)
         {
           if (iProc == procID)
             {
-              ost << "Proc " << procID
-                  << "\n  RegionSend" << regionSend
-                  << "\n  RegionRecv" << regionRecv << std::endl;
-              std::cout << ost.str();
-              ost.str("");
+              for (DataIterator dit(dbl); dit.ok(); ++dit)
+                {
+                  BaseFab<Real>& fab = lvldata[dit];
+                  if (verbose)
+                    {
+                      int interiorCell = (procID == 0) ? 3 : 4;
+                      int ghostCell = (procID == 0) ? 4 : 3;
+                      ost << "Proc " << procID
+                          << "\n  Interior: "
+                          << fab(IntVect(D_DECL(interiorCell, 0, 0)), 0)
+                          << "\n  Ghost: "
+                          << fab(IntVect(D_DECL(ghostCell, 0, 0)), 0)
+                          << std::endl;
+                      std::cout<< ost.str();
+                      ost.str("");
+                    }
+                  // Expect value from other processor
+                  const Real val = ((procID == 0) ? 1.5 : 0.5) + pass;
+                  for (BoxIterator bit(regionRecv); bit.ok(); ++bit)
+                    {
+                      if (fab(*bit, 0) != val) ++status;
+                    }
+                }
             }
           MPI_Barrier(MPI_COMM_WORLD);
         }
     }
-  for (int iProc = 0; iProc != numProc; ++iProc)
+#endif
+
+  // Periodic exchange with many boxes on each process so that messages
+  // grouped per process contain many motion items
+  {
+    const int n = 12;
+    const Box domainP(IntVect::Zero, (n - 1)*IntVect::Unit);
+    DisjointBoxLayout dblP(domainP, 4*IntVect::Unit, BoxOrder::morton);
+    LevelData<BaseFab<Real> > lvldataP(dblP, 2, 1);
+    // A value unique to each cell in the periodic domain
+    auto cellVal = [n](IntVect a_iv, const int a_comp) -> Real
+      {
+        for (int dir = 0; dir != g_SpaceDim; ++dir)
+          {
+            a_iv[dir] = (a_iv[dir] + n) % n;
+          }
+        return D_TERM(a_iv[0], + 100*a_iv[1], + 10000*a_iv[2]) +
+          0.5*a_comp;
+      };
+    const CopierProtocol protocol[] = {
+      CopierProtocol::persistent,
+      CopierProtocol::nonblocking,
+      CopierProtocol::persistent,
+      CopierProtocol::putFence,
+      CopierProtocol::putPSCW,
+      CopierProtocol::putPSCW,
+      CopierProtocol::neighborhood,
+      CopierProtocol::neighborhood
+    };
+    const CopierMessages messages[] = {
+      CopierMessages::perProcess,
+      CopierMessages::perProcess,
+      CopierMessages::perMotionItem,
+      CopierMessages::perProcess,
+      CopierMessages::perProcess,
+      CopierMessages::perMotionItem,
+      CopierMessages::perProcess,
+      CopierMessages::perMotionItem
+    };
+    for (int iCopier = 0; iCopier != 8; ++iCopier)
+      {
+        Copier copierP(protocol[iCopier], messages[iCopier]);
+        copierP.defineExchangeLD(lvldataP, PeriodicX | PeriodicY | PeriodicZ);
+        if (messages[iCopier] == CopierMessages::perProcess &&
+            copierP.numMessage() != 1) ++status;
+        if (copierP.isOneSided() && copierP.numRequest() != 0) ++status;
+        // Messages of a neighborhood collective are always grouped
+        if (protocol[iCopier] == CopierProtocol::neighborhood &&
+            (copierP.numMessage() != 1 || copierP.numRequest() != 1)) ++status;
+        // The second exchange checks that the one-sided epochs and the
+        // collective are restarted
+        for (int pass = 0; pass != 2; ++pass)
+          {
+            for (DataIterator dit(dblP); dit.ok(); ++dit)
+              {
+                BaseFab<Real>& fab = lvldataP[dit];
+                fab.setVal(-1.);
+                for (BoxIterator bit(dblP[dit]); bit.ok(); ++bit)
+                  {
+                    fab(*bit, 0) = cellVal(*bit, 0);
+                    fab(*bit, 1) = cellVal(*bit, 1);
+                  }
+              }
+            lvldataP.exchange(copierP);
+          }
+        int numErr = 0;
+        for (DataIterator dit(dblP); dit.ok(); ++dit)
+          {
+            const BaseFab<Real>& fab = lvldataP[dit];
+            for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+              {
+                if (fab(*bit, 0) != cellVal(*bit, 0) ||
+                    fab(*bit, 1) != cellVal(*bit, 1)) ++numErr;
+              }
+          }
+        if (verbose && numErr)
+          {
+            ost << "Proc " << procID << " copier " << iCopier << ": "
+                << numErr << " errors" << std::endl;
+            std::cout << ost.str();
+            ost.str("");
+          }
+        status += numErr;
+      }
+
+    // Only component 0 is moved in directions with an x part and only
+    // component 1 in the others.  Messages only carry one component.
     {
-      if (iProc == procID)
+      auto dirCompSet = [](const IntVect& a_dir) -> CompSet
         {
-          for (DataIterator dit(dbl); dit.ok(); ++dit)
+          return (a_dir[0] != 0) ? CompSet({ 0 }) : CompSet({ 1 });
+        };
+      Copier copierC;
+      copierC.defineExchangeLD(lvldataP, PeriodicX | PeriodicY | PeriodicZ, 0u,
+                               dirCompSet);
+      for (int i = 0, i_end = copierC.numMotionItem(); i != i_end; ++i)
+        {
+          const Motion2Way& motion = copierC[i];
+          if (!motion.isDirect() &&
+              (motion.numBytesRecv() !=
+               sizeof(Real)*motion.regionRecv().size())) ++status;
+        }
+      // The same policy given to setDirCompSet instead
+      Copier copierD;
+      copierD.setDirCompSet(dirCompSet);
+      copierD.defineExchangeLD(lvldataP, PeriodicX | PeriodicY | PeriodicZ);
+      if (copierD.numMotionItem() != copierC.numMotionItem()) ++status;
+      for (int i = 0, i_end = std::min(copierC.numMotionItem(),
+                                       copierD.numMotionItem());
+           i != i_end; ++i)
+        {
+          if (copierD[i].numBytesRecv() != copierC[i].numBytesRecv() ||
+              copierD[i].numBytesSend() != copierC[i].numBytesSend()) ++status;
+        }
+      for (DataIterator dit(dblP); dit.ok(); ++dit)
+        {
+          BaseFab<Real>& fab = lvldataP[dit];
+          fab.setVal(-1.);
+          for (BoxIterator bit(dblP[dit]); bit.ok(); ++bit)
             {
-              BaseFab<Real>& fab = lvldata[dit];
-              if (verbose)
-                {
-                  int interiorCell = (procID == 0) ? 3 : 4;
-                  int ghostCell = (procID == 0) ? 4 : 3;
-                  ost << "Proc " << procID
-                      << "\n  Interior: "
-                      << fab(IntVect(D_DECL(interiorCell, 0, 0)), 0)
-                      << "\n  Ghost: "
-                      << fab(IntVect(D_DECL(ghostCell, 0, 0)), 0)
-                      << std::endl;
-                  std::cout<< ost.str();
-                  ost.str("");
-                }
-              // Expect value from other processor
-              const Real val = (procID == 0) ? 1.5 : 0.5;
-              for (BoxIterator bit(regionRecv); bit.ok(); ++bit)
+              fab(*bit, 0) = cellVal(*bit, 0);
+              fab(*bit, 1) = cellVal(*bit, 1);
+            }
+        }
+      lvldataP.exchange(copierC);
+      int numErr = 0;
+      for (DataIterator dit(dblP); dit.ok(); ++dit)
+        {
+          const Box& box = dblP[dit];
+          const BaseFab<Real>& fab = lvldataP[dit];
+          for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+            {
+              if (box.contains(*bit)) continue;
+              const int compMoved = ((*bit)[0] < box.loVect()[0] ||
+                                     (*bit)[0] > box.hiVect()[0]) ? 0 : 1;
+              for (int comp = 0; comp != 2; ++comp)
                 {
-                  if (fab(*bit, 0) != val) ++status;
+                  const Real expect =
+                    (comp == compMoved) ? cellVal(*bit, comp) : -1.;
+                  if (fab(*bit, comp) != expect) ++numErr;
                 }
             }
         }
-      MPI_Barrier(MPI_COMM_WORLD);
+      if (verbose && numErr)
+        {
+          ost << "Proc " << procID << " component sets: " << numErr
+              << " errors" << std::endl;
+          std::cout << ost.str();
+          ost.str("");
+        }
+      status += numErr;
     }
-#endif
+
+    // Several LevelData exchanged in one round of messages.  Only
+    // components 1 and 2 of the second are exchanged.
+    LevelData<BaseFab<Real> > lvldataQ(dblP, 3, 1);
+    LevelData<BaseFab<Real> > lvldataR(dblP, 1, 1);
+    LevelData<BaseFab<Real> >* lvldataGrp[] = {
+      &lvldataP, &lvldataQ, &lvldataR
+    };
+    LevelDataGroup<BaseFab<Real> > group;
+    group.add(lvldataP);
+    group.add(lvldataQ, 1, 2);
+    group.add(lvldataR);
+    if (group.size() != 3 || group.numComp() != 5) ++status;
+    Copier copierGrp;
+    group.defineCopier(copierGrp, PeriodicX | PeriodicY | PeriodicZ);
+    if (copierGrp.numMessage() != 1) ++status;
+    for (int iLD = 0; iLD != 3; ++iLD)
+      {
+        for (DataIterator dit(dblP); dit.ok(); ++dit)
+          {
+            BaseFab<Real>& fab = (*lvldataGrp[iLD])[dit];
+            fab.setVal(-1.);
+            for (BoxIterator bit(dblP[dit]); bit.ok(); ++bit)
+              {
+                for (int c = 0; c != fab.ncomp(); ++c)
+                  {
+                    fab(*bit, c) = cellVal(*bit, c + 4*iLD);
+                  }
+              }
+          }
+      }
+    group.exchange(copierGrp);
+    int numErr = 0;
+    for (int iLD = 0; iLD != 3; ++iLD)
+      {
+        for (DataIterator dit(dblP); dit.ok(); ++dit)
+          {
+            const BaseFab<Real>& fab = (*lvldataGrp[iLD])[dit];
+            for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+              {
+                const bool valid = dblP[dit].contains(*bit);
+                for (int c = 0; c != fab.ncomp(); ++c)
+                  {
+                    const Real val = (valid || iLD != 1 || c != 0) ?
+                      cellVal(*bit, c + 4*iLD) : -1.;
+                    if (fab(*bit, c) != val) ++numErr;
+                  }
+              }
+          }
+      }
+    if (verbose && numErr)
+      {
+        ost << "Proc " << procID << " group: " << numErr << " errors"
+            << std::endl;
+        std::cout << ost.str();
+        ost.str("");
+      }
+    status += numErr;
+
+    // Direct copies from memory shared on the node.  Nodes of 1 and 2
+    // processes are emulated to also test a mix with messages.
+    const int maxNodeProc[] = { 1, 2, 0 };
+    for (int iNode = 0; iNode != 3; ++iNode)
+      {
+        DisjointBoxLayout::defineNodes(maxNodeProc[iNode]);
+        LevelData<BaseFab<Real> > lvldataS;
+        lvldataS.defineShared(dblP, 2, 1);
+        if (!lvldataS.isShared()) ++status;
+        Copier copierS(CopierProtocol::persistent,
+                       CopierMessages::perProcess,
+                       CopierOnNode::sharedMemory);
+        copierS.defineExchangeLD(lvldataS, PeriodicX | PeriodicY | PeriodicZ);
+        if (DisjointBoxLayout::numNodeProc() == numProc &&
+            copierS.numMessage() != 0) ++status;
+        numErr = 0;
+        // The last pass exchanges with tasks of a graph
+        TaskGraph graph;
+        std::vector<int> validTask(dblP.localSize(), -1);
+        std::vector<int> ghostTask;
+        lvldataS.addExchangeTasks(graph, copierS, validTask, ghostTask);
+        for (int pass = 0; pass != 3; ++pass)
+          {
+            for (DataIterator dit(dblP); dit.ok(); ++dit)
+              {
+                BaseFab<Real>& fab = lvldataS[dit];
+                fab.setVal(-1.);
+                for (BoxIterator bit(dblP[dit]); bit.ok(); ++bit)
+                  {
+                    fab(*bit, 0) = cellVal(*bit, 0) + pass;
+                    fab(*bit, 1) = cellVal(*bit, 1) + pass;
+                  }
+              }
+            if (pass < 2)
+              {
+                lvldataS.exchange(copierS);
+              }
+            else
+              {
+                graph.execute();
+              }
+            for (DataIterator dit(dblP); dit.ok(); ++dit)
+              {
+                const BaseFab<Real>& fab = lvldataS[dit];
+                for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+                  {
+                    if (fab(*bit, 0) != cellVal(*bit, 0) + pass ||
+                        fab(*bit, 1) != cellVal(*bit, 1) + pass) ++numErr;
+                  }
+              }
+          }
+        if (verbose && numErr)
+          {
+            ost << "Proc " << procID << " shared (node " << maxNodeProc[iNode]
+                << "): " << numErr << " errors" << std::endl;
+            std::cout << ost.str();
+            ost.str("");
+          }
+        status += numErr;
+      }
+  }
 
   // Get sum of all status into master process
   int allStatus;
@@ -0,0 +1,321 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <atomic>
+
+#include "TaskGraph.H"
+#include "ThreadPool.H"
+#include "LevelData.H"
+#include "LinuxSupport.H"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+int main(const int argc, const char* argv[])
+{
+  const bool verbose = ((argc == 2) && (std::strcmp(argv[1], "-v") == 0));
+  const char* const statLbl[] = {
+    "failed",
+    "passed"
+  };
+  int status = 0;
+
+  ThreadPool::define(4, false);
+
+//--Tests
+
+  // Every task runs once, after the tasks it depends on, in every
+  // execution.  Master tasks run on the calling thread.
+  {
+    int statusOrder = 0;
+    TaskGraph graph;
+    const int numLayer = 6;
+    const int numWidth = 20;
+    // Order in which each task was run
+    std::vector<std::atomic<int> > stamp(numLayer*numWidth + 1);
+    std::atomic<int> counter(0);
+    std::atomic<int> numErr(0);
+    std::vector<int> task(numLayer*numWidth);
+    for (int layer = 0; layer != numLayer; ++layer)
+      {
+        for (int i = 0; i != numWidth; ++i)
+          {
+            const int idx = layer*numWidth + i;
+            const TaskPriority priority = (i == 0) ?
+              TaskPriority::master :
+              ((i % 3 == 0) ? TaskPriority::urgent : TaskPriority::normal);
+            task[idx] = graph.addTask(
+              [&, i, idx, priority]
+              {
+                if (priority == TaskPriority::master &&
+                    ThreadPool::threadIndex() != 0) ++numErr;
+                if (i % 5 == 0)
+                  {
+                    volatile double x = 0.;
+                    for (int j = 0; j != 20000; ++j) x = x + 1.;
+                  }
+                stamp[idx] = ++counter;
+              },
+              priority);
+            if (layer > 0)
+              {
+                // Depends on the neighbors in the previous layer
+                for (int d = -1; d <= 1; ++d)
+                  {
+                    graph.addDependency(
+                      task[idx],
+                      task[(layer - 1)*numWidth + (i + d + numWidth) %
+                           numWidth]);
+                  }
+              }
+          }
+      }
+    // A join of the last layer
+    const int join = graph.addJoin();
+    for (int i = 0; i != numWidth; ++i)
+      {
+        graph.addDependency(join, task[(numLayer - 1)*numWidth + i]);
+      }
+    graph.addDependency(join, -1);
+    if (graph.numTask() != numLayer*numWidth + 1) ++statusOrder;
+    for (int exec = 0; exec != 20; ++exec)
+      {
+        counter = 0;
+        for (std::atomic<int>& s : stamp) s = 0;
+        graph.execute();
+        if (counter.load() != numLayer*numWidth) ++statusOrder;
+        for (int layer = 1; layer != numLayer; ++layer)
+          {
+            for (int i = 0; i != numWidth; ++i)
+              {
+                const int idx = layer*numWidth + i;
+                for (int d = -1; d <= 1; ++d)
+                  {
+                    const int pred =
+                      (layer - 1)*numWidth + (i + d + numWidth) % numWidth;
+                    if (stamp[pred].load() == 0 ||
+                        stamp[pred].load() >= stamp[idx].load())
+                      ++statusOrder;
+                  }
+              }
+          }
+      }
+    statusOrder += numErr.load();
+    graph.clear();
+    if (graph.numTask() != 0) ++statusOrder;
+    graph.execute();
+    if (verbose || statusOrder != 0)
+      {
+        std::cout << "Order test " << statLbl[(statusOrder == 0)]
+                  << std::endl;
+      }
+    status += statusOrder;
+  }
+
+  // Exchange tasks fill the same ghost cells as an exchange, including
+  // when the valid cells of each box are only set by a task
+  {
+    int statusExchange = 0;
+    IntVect domainLo(D_DECL(1, -1, 1));
+    Box domain(domainLo, domainLo + 11*IntVect::Unit);
+    DisjointBoxLayout dbl(domain, 4*IntVect::Unit);
+    const unsigned periodic = PeriodicX | PeriodicY | PeriodicZ;
+    LevelData<BaseFab<Real> > lvldata(dbl, 2, 1);
+    LevelData<BaseFab<Real> > lvldataB(dbl, 3, 1);
+    LevelData<BaseFab<Real> > lvldataRef(dbl, 2, 1);
+    LevelData<BaseFab<Real> > lvldataBRef(dbl, 3, 1);
+    auto cellVal = [](const IntVect& a_iv, const int a_comp) -> Real
+      {
+        return D_TERM(a_iv[0], + 100*a_iv[1], + 10000*a_iv[2]) +
+          1000000*a_comp;
+      };
+    auto setValid = [&](LevelData<BaseFab<Real> >& a_lvldata,
+                        const BoxIndex&            a_didx,
+                        const int                  a_offset)
+      {
+        BaseFab<Real>& fab = a_lvldata[a_didx];
+        fab.setVal(-1.);
+        for (BoxIterator bit(dbl[a_didx]); bit.ok(); ++bit)
+          {
+            for (int comp = 0; comp != fab.ncomp(); ++comp)
+              {
+                fab(*bit, comp) = cellVal(*bit, comp + a_offset);
+              }
+          }
+      };
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        setValid(lvldataRef, *dit, 0);
+        setValid(lvldataBRef, *dit, 2);
+      }
+    LevelDataGroup<BaseFab<Real> > groupRef;
+    groupRef.add(lvldataRef);
+    groupRef.add(lvldataBRef, 1, 2);
+    groupRef.exchange(periodic);
+
+    LevelDataGroup<BaseFab<Real> > group;
+    group.add(lvldata);
+    group.add(lvldataB, 1, 2);
+    TaskGraph graph;
+    std::vector<int> validTask;
+    std::vector<BoxIndex> didx;
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BoxIndex d = *dit;
+        didx.push_back(d);
+        validTask.push_back(graph.addTask(
+                              [&, d]
+                              {
+                                setValid(lvldata, d, 0);
+                                setValid(lvldataB, d, 2);
+                              }));
+      }
+    std::vector<int> ghostTask;
+    group.addExchangeTasks(graph, validTask, ghostTask, periodic);
+    if (ghostTask.size() != didx.size()) ++statusExchange;
+    // Each box checks its ghost cells as soon as they are filled
+    std::atomic<int> numErr(0);
+    for (int ib = 0, ib_end = didx.size(); ib != ib_end; ++ib)
+      {
+        const int task = graph.addTask(
+          [&, ib]
+          {
+            const BoxIndex& d = didx[ib];
+            for (BoxIterator bit(lvldata[d].box()); bit.ok(); ++bit)
+              {
+                for (int comp = 0; comp != 2; ++comp)
+                  {
+                    if (lvldata[d](*bit, comp) != lvldataRef[d](*bit, comp))
+                      ++numErr;
+                  }
+              }
+            for (BoxIterator bit(lvldataB[d].box()); bit.ok(); ++bit)
+              {
+                for (int comp = 0; comp != 3; ++comp)
+                  {
+                    if (lvldataB[d](*bit, comp) != lvldataBRef[d](*bit, comp))
+                      ++numErr;
+                  }
+              }
+          });
+        graph.addDependency(task, ghostTask[ib]);
+      }
+    for (int exec = 0; exec != 5; ++exec)
+      {
+        graph.execute();
+      }
+    statusExchange += numErr.load();
+
+    // A single LevelData with a copier and valid cells set beforehand
+    LevelData<BaseFab<Real> > lvldataS(dbl, 2, 1);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        setValid(lvldataS, *dit, 0);
+      }
+    Copier copier;
+    copier.defineExchangeLD(lvldataS, periodic);
+    TaskGraph graphS;
+    std::vector<int> noTask(didx.size(), -1);
+    lvldataS.addExchangeTasks(graphS, copier, noTask, ghostTask);
+    graphS.execute();
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        for (BoxIterator bit(lvldataS[dit].box()); bit.ok(); ++bit)
+          {
+            for (int comp = 0; comp != 2; ++comp)
+              {
+                if (lvldataS[dit](*bit, comp) != lvldataRef[dit](*bit, comp))
+                  ++statusExchange;
+              }
+          }
+      }
+    Copier::clearCache();
+    if (verbose || statusExchange != 0)
+      {
+        std::cout << "Exchange test " << statLbl[(statusExchange == 0)]
+                  << std::endl;
+      }
+    status += statusExchange;
+  }
+
+#ifdef _OPENMP
+  // Large copies made by exchange tasks do not start OpenMP teams on the
+  // threads of the pool, even if OpenMP would use several threads on
+  // each of them (as with OMP_NUM_THREADS)
+  {
+    int statusOmp = 0;
+    // A face of 128x128 cells and 2 components is s_ompMinElem elements
+    Box domain(IntVect::Zero, IntVect(D_DECL(127, 127, 15)));
+    DisjointBoxLayout dbl(domain, IntVect(D_DECL(128, 128, 8)));
+    const unsigned periodic = PeriodicX | PeriodicY | PeriodicZ;
+    LevelData<BaseFab<Real> > lvldata(dbl, 2, 1);
+    LevelData<BaseFab<Real> > lvldataRef(dbl, 2, 1);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        for (int comp = 0; comp != 2; ++comp)
+          {
+            lvldataRef[dit].setVal(comp, dbl[dit].loVect().sum() + comp);
+          }
+      }
+    lvldataRef.exchange(periodic);
+    ThreadPool::instance().parallel([](const int)
+                                    {
+                                      omp_set_num_threads(4);
+                                    });
+    TaskGraph graph;
+    std::vector<int> validTask;
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BoxIndex d = *dit;
+        validTask.push_back(graph.addTask(
+                              [&, d]
+                              {
+                                lvldata[d].setVal(-1.);
+                                lvldata[d].copy(dbl[d], lvldataRef[d]);
+                              }));
+      }
+    std::vector<int> ghostTask;
+    LevelDataGroup<BaseFab<Real> > group;
+    group.add(lvldata);
+    group.addExchangeTasks(graph, validTask, ghostTask, periodic);
+    // Executing the graph must not start any thread
+    const int numThread0 = System::numThread();
+    graph.execute();
+    if (System::numThread() != numThread0) ++statusOmp;
+    ThreadPool::instance().parallel([](const int)
+                                    {
+                                      omp_set_num_threads(1);
+                                    });
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        for (BoxIterator bit(lvldata[dit].box()); bit.ok(); ++bit)
+          {
+            for (int comp = 0; comp != 2; ++comp)
+              {
+                if (lvldata[dit](*bit, comp) != lvldataRef[dit](*bit, comp))
+                  ++statusOmp;
+              }
+          }
+      }
+    Copier::clearCache();
+    if (verbose || statusOmp != 0)
+      {
+        std::cout << "OpenMP test " << statLbl[(statusOmp == 0)]
+                  << std::endl;
+      }
+    status += statusOmp;
+  }
+#endif
+
+//--Output status
+
+  if (verbose)
+    {
+      std::cout << "Status: " << status << std::endl;
+    }
+  const char* const testName = "testTaskGraph";
+  std::cout << std::left << std::setw(40) << testName
+            << statLbl[(status == 0)] << std::endl;
+  return status;
+}
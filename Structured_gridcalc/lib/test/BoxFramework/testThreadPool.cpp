@@ -0,0 +1,194 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <atomic>
+
+#include "ThreadPool.H"
+#include "LevelData.H"
+
+int main(const int argc, const char* argv[])
+{
+  const bool verbose = ((argc == 2) && (std::strcmp(argv[1], "-v") == 0));
+  const char* const statLbl[] = {
+    "failed",
+    "passed"
+  };
+  int status = 0;
+
+//--Tests
+
+  // Every item is run exactly once, in every loop, even when a few items
+  // have much more work than the others
+  {
+    int statusLoop = 0;
+    ThreadPool::define(4, false);
+    ThreadPool& pool = ThreadPool::instance();
+    if (pool.numThread() != 4) ++statusLoop;
+    if (ThreadPool::threadIndex() != -1) ++statusLoop;
+    const int numItem = 1000;
+    std::vector<std::atomic<int> > count(numItem);
+    std::atomic<int> numErr(0);
+    for (int loop = 0; loop != 50; ++loop)
+      {
+        for (std::atomic<int>& c : count) c.store(0);
+        pool.parallelFor(
+          numItem,
+          [&](const int a_itemBegin, const int a_itemEnd)
+          {
+            const int thread = ThreadPool::threadIndex();
+            if (thread < 0 || thread >= pool.numThread()) ++numErr;
+            if (a_itemBegin < 0 || a_itemEnd > numItem) ++numErr;
+            for (int item = a_itemBegin; item < a_itemEnd; ++item)
+              {
+                if (item < 10)
+                  {
+                    volatile double x = 0.;
+                    for (int i = 0; i != 100000; ++i) x = x + 1.;
+                  }
+                ++count[item];
+              }
+          });
+        for (const std::atomic<int>& c : count)
+          {
+            if (c.load() != 1) ++statusLoop;
+          }
+      }
+    statusLoop += numErr.load();
+    if (ThreadPool::threadIndex() != -1) ++statusLoop;
+    if (verbose || statusLoop != 0)
+      {
+        std::cout << "Loop test " << statLbl[(statusLoop == 0)]
+                  << std::endl;
+      }
+    status += statusLoop;
+  }
+
+  // Loops started from within a loop run on the calling thread
+  {
+    int statusNested = 0;
+    ThreadPool& pool = ThreadPool::instance();
+    std::atomic<int> sum(0);
+    std::atomic<int> numErr(0);
+    pool.parallelFor(
+      8,
+      [&](const int a_itemBegin, const int a_itemEnd)
+      {
+        const int thread = ThreadPool::threadIndex();
+        pool.parallelFor(
+          5,
+          [&](const int a_innerBegin, const int a_innerEnd)
+          {
+            if (ThreadPool::threadIndex() != thread) ++numErr;
+            sum += (a_itemEnd - a_itemBegin)*(a_innerEnd - a_innerBegin);
+          });
+      });
+    if (sum.load() != 40) ++statusNested;
+    statusNested += numErr.load();
+    if (verbose || statusNested != 0)
+      {
+        std::cout << "Nested loop test " << statLbl[(statusNested == 0)]
+                  << std::endl;
+      }
+    status += statusNested;
+  }
+
+  // Tiles of a LevelData cover each valid cell once and first touch by
+  // the pool sets the ghost cells too
+  {
+    int statusLD = 0;
+    IntVect domainLo(D_DECL(1, -1, 1));
+    Box domain(domainLo, domainLo + 11*IntVect::Unit);
+    DisjointBoxLayout dbl(domain, 4*IntVect::Unit);
+    LevelData<BaseFab<int> > lvldata(dbl, 2, 1);
+    const IntVect tileSize(D_DECL(3, 2, 4));
+    lvldata.setVal(-1, FirstTouch::threadPool, tileSize);
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        const BaseFab<int>& fab = lvldata[dit];
+        for (int i = 0, i_end = fab.size(); i != i_end; ++i)
+          {
+            if (fab.dataPtr()[i] != -1) ++statusLD;
+          }
+      }
+    lvldata.setVal(0);
+    std::atomic<int> numErr(0);
+    lvldata.parallelFor(
+      tileSize,
+      [&](const TileIterator& a_tit)
+      {
+        if (!a_tit.validBox().contains(a_tit.tileBox())) ++numErr;
+        BaseFab<int>& fab = lvldata[a_tit];
+        for (BoxIterator bit(a_tit.tileBox()); bit.ok(); ++bit)
+          {
+            ++fab(*bit, 0);
+          }
+      });
+    // One item per box
+    std::atomic<int> numBox(0);
+    lvldata.parallelFor(
+      [&](const TileIterator& a_tit)
+      {
+        if (a_tit.tileBox() != a_tit.validBox()) ++numErr;
+        ++numBox;
+        BaseFab<int>& fab = lvldata[a_tit];
+        for (BoxIterator bit(a_tit.validBox()); bit.ok(); ++bit)
+          {
+            ++fab(*bit, 1);
+          }
+      });
+    statusLD += numErr.load();
+    int numLocalBox = 0;
+    for (DataIterator dit(dbl); dit.ok(); ++dit)
+      {
+        ++numLocalBox;
+        const Box& box = dbl[dit];
+        const BaseFab<int>& fab = lvldata[dit];
+        for (BoxIterator bit(fab.box()); bit.ok(); ++bit)
+          {
+            const int expected = box.contains(*bit);
+            if (fab(*bit, 0) != expected) ++statusLD;
+            if (fab(*bit, 1) != expected) ++statusLD;
+          }
+      }
+    if (numBox.load() != numLocalBox) ++statusLD;
+    if (TileIterator::numItem(dbl, tileSize) != numLocalBox*D_TERM(2, *2, *1))
+      ++statusLD;
+    if (verbose || statusLD != 0)
+      {
+        std::cout << "LevelData test " << statLbl[(statusLD == 0)]
+                  << std::endl;
+      }
+    status += statusLD;
+  }
+
+  // Pinned threads
+  {
+    int statusPin = 0;
+    ThreadPool::define(2, true);
+    std::atomic<int> sum(0);
+    ThreadPool::instance().parallelFor(
+      100,
+      [&](const int a_itemBegin, const int a_itemEnd)
+      {
+        sum += a_itemEnd - a_itemBegin;
+      });
+    if (sum.load() != 100) ++statusPin;
+    if (verbose || statusPin != 0)
+      {
+        std::cout << "Pinned test " << statLbl[(statusPin == 0)]
+                  << std::endl;
+      }
+    status += statusPin;
+  }
+
+//--Output status
+
+  if (verbose)
+    {
+      std::cout << "Status: " << status << std::endl;
+    }
+  const char* const testName = "testThreadPool";
+  std::cout << std::left << std::setw(40) << testName
+            << statLbl[(status == 0)] << std::endl;
+  return status;
+}